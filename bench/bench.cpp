@@ -0,0 +1,443 @@
+#include <cstdlib>
+#include <cstring>
+
+#include <chrono>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <fe/arena.h>
+#include <fe/loc.cpp.h>
+#include <fe/ring.h>
+#include <fe/sym.h>
+#include <fe/utf8.h>
+
+#include "lexer.h"
+
+// All corpora are generated from a fixed seed so runs on the same machine are comparable.
+// Run via `cmake --build . --target bench` or pass Google Benchmark flags directly, e.g.:
+// `fe-bench --benchmark_filter=Lexer --benchmark_format=json`
+
+namespace {
+
+constexpr uint64_t Seed = 0xfe;
+
+/// @name Corpora
+///@{
+void append(std::u8string& s, char32_t c) {
+    char8_t buf[utf8::Max];
+    s.append(buf, utf8::encode(buf, c));
+}
+
+/// Mostly ASCII prose with a sprinkle of Greek and CJK - what source code looks like.
+const std::u8string& ascii_corpus() {
+    static const auto corpus = [] {
+        std::mt19937_64 rng(Seed);
+        std::u8string s;
+        while (s.size() < (1 << 20)) {
+            auto r = rng() % 100;
+            if (r == 0) {
+                append(s, U'λ');
+            } else if (r == 1) {
+                append(s, U'変');
+            } else if (r < 15) {
+                s += u8' ';
+            } else {
+                s += char8_t('a' + rng() % 26);
+            }
+        }
+        return s;
+    }();
+    return corpus;
+}
+
+/// CJK ideographs separated by the odd ASCII space.
+const std::u8string& cjk_corpus() {
+    static const auto corpus = [] {
+        std::mt19937_64 rng(Seed);
+        std::u8string s;
+        while (s.size() < (1 << 20)) {
+            if (rng() % 10 == 0)
+                s += u8' ';
+            else
+                append(s, char32_t(0x4e00 + rng() % (0x9fff - 0x4e00)));
+        }
+        return s;
+    }();
+    return corpus;
+}
+
+/// A program in the language of the reference Lexer from tests/lexer.h.
+const std::u8string& program_corpus() {
+    static const auto corpus = [] {
+        static constexpr const char* Ops[] = {" + ", " - ", " * ", " / "};
+        std::mt19937_64 rng(Seed);
+        auto id = [&] {
+            std::string res(1 + rng() % 12, 'a');
+            for (auto& c : res) c = char('a' + rng() % 26);
+            if (rng() % 4 == 0) res += '_' + std::to_string(rng() % 100);
+            return res;
+        };
+
+        std::string s;
+        while (s.size() < (1 << 20)) {
+            s += rng() % 2 ? "let " : "    return ";
+            s += id() + " = ";
+            for (size_t i = 0, e = 1 + rng() % 6; i != e; ++i) {
+                if (i != 0) s += Ops[rng() % 4];
+                if (rng() % 8 == 0) s += "λ ";
+                s += rng() % 3 == 0 ? std::to_string(rng() % 100000) : id();
+            }
+            s += ";\n";
+        }
+        return std::u8string(s.begin(), s.end());
+    }();
+    return corpus;
+}
+
+/// @p n distinct strings of length [@p min, @p max].
+std::vector<std::string> strings(size_t n, size_t min, size_t max) {
+    std::mt19937_64 rng(Seed);
+    std::unordered_set<std::string> seen;
+    std::vector<std::string> res;
+    while (res.size() != n) {
+        std::string str(min + rng() % (max - min + 1), 'a');
+        for (auto& c : str) c = char('a' + rng() % 26);
+        if (seen.emplace(str).second) res.emplace_back(std::move(str));
+    }
+    return res;
+}
+///@}
+
+/// @name utf8
+///@{
+void BM_utf8_decode(benchmark::State& state, const std::u8string& (*corpus)()) {
+    auto& in = corpus();
+    for (auto _ : state) {
+        char32_t sum = 0;
+        for (auto p = in.data(), e = p + in.size(); p != e;) sum += utf8::decode(p, e);
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(int64_t(state.iterations() * in.size()));
+}
+BENCHMARK_CAPTURE(BM_utf8_decode, ascii, ascii_corpus);
+BENCHMARK_CAPTURE(BM_utf8_decode, cjk, cjk_corpus);
+
+void BM_utf8_validate(benchmark::State& state, const std::u8string& (*corpus)()) {
+    auto& in = corpus();
+    for (auto _ : state) benchmark::DoNotOptimize(utf8::is_valid(in));
+    state.SetBytesProcessed(int64_t(state.iterations() * in.size()));
+}
+BENCHMARK_CAPTURE(BM_utf8_validate, ascii, ascii_corpus);
+BENCHMARK_CAPTURE(BM_utf8_validate, cjk, cjk_corpus);
+///@}
+
+/// @name Lexer
+///@{
+template<size_t K> void BM_Lexer_buffer(benchmark::State& state) {
+    auto& in = program_corpus();
+    fe::Driver driver;
+    size_t num_toks = 0;
+    for (auto _ : state) {
+        ::Lexer<K> lexer(driver, std::span<const char8_t>(in.data(), in.size()));
+        while (lexer.lex().tag() != Tok::Tag::T_EoF) ++num_toks;
+    }
+    state.SetBytesProcessed(int64_t(state.iterations() * in.size()));
+    state.SetItemsProcessed(int64_t(num_toks));
+}
+BENCHMARK_TEMPLATE(BM_Lexer_buffer, 1);
+BENCHMARK_TEMPLATE(BM_Lexer_buffer, 2);
+
+template<size_t K> void BM_Lexer_istream(benchmark::State& state) {
+    auto& in = program_corpus();
+    fe::Driver driver;
+    size_t num_toks = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::istringstream is(std::string((const char*)in.data(), in.size()));
+        state.ResumeTiming();
+        ::Lexer<K> lexer(driver, is);
+        while (lexer.lex().tag() != Tok::Tag::T_EoF) ++num_toks;
+    }
+    state.SetBytesProcessed(int64_t(state.iterations() * in.size()));
+    state.SetItemsProcessed(int64_t(num_toks));
+}
+BENCHMARK_TEMPLATE(BM_Lexer_istream, 1);
+BENCHMARK_TEMPLATE(BM_Lexer_istream, 2);
+///@}
+
+/// @name SymPool
+///@{
+constexpr size_t Num_Syms = 4096;
+
+/// Arguments: min & max string length - `[1, 6]` is inlined into Sym on 64-bit targets.
+void BM_SymPool_hit(benchmark::State& state) {
+    auto strs = strings(Num_Syms, state.range(0), state.range(1));
+    fe::SymPool pool;
+    for (auto& str : strs) pool.sym(str);
+
+    for (auto _ : state)
+        for (auto& str : strs) benchmark::DoNotOptimize(pool.sym(str));
+    state.SetItemsProcessed(int64_t(state.iterations() * strs.size()));
+}
+BENCHMARK(BM_SymPool_hit)->ArgNames({"min", "max"})->Args({1, 6})->Args({8, 24})->Args({32, 64});
+
+void BM_SymPool_miss(benchmark::State& state) {
+    auto strs = strings(Num_Syms, state.range(0), state.range(1));
+    for (auto _ : state) {
+        auto pool = std::make_unique<fe::SymPool>();
+        for (auto& str : strs) benchmark::DoNotOptimize(pool->sym(str));
+        state.PauseTiming();
+        pool.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * strs.size()));
+}
+BENCHMARK(BM_SymPool_miss)->ArgNames({"min", "max"})->Args({1, 6})->Args({8, 24})->Args({32, 64});
+
+/// Case-insensitive hits: SymPool::sym_fold vs. lowering char by char into a `std::string` first - which is what
+/// Lexer::Append::Lower amounts to.
+template<bool Fold> void BM_SymPool_fold(benchmark::State& state) {
+    auto strs = strings(Num_Syms, state.range(0), state.range(1));
+    fe::SymPool pool;
+    for (auto& str : strs) {
+        pool.sym(str);
+        for (size_t i = 0; i < str.size(); i += 2) str[i] = char(fe::utf8::toupper(str[i]));
+    }
+
+    for (auto _ : state) {
+        for (auto& str : strs) {
+            if constexpr (Fold) {
+                benchmark::DoNotOptimize(pool.sym_fold(str));
+            } else {
+                std::string lower;
+                for (auto c : str) lower += char(fe::utf8::tolower(c));
+                benchmark::DoNotOptimize(pool.sym(lower));
+            }
+        }
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * strs.size()));
+}
+BENCHMARK_TEMPLATE(BM_SymPool_fold, true)->ArgNames({"min", "max"})->Args({8, 24})->Args({32, 64});
+BENCHMARK_TEMPLATE(BM_SymPool_fold, false)->ArgNames({"min", "max"})->Args({8, 24})->Args({32, 64});
+
+/// Cold start from a SymPool::dump%ed image - compare with BM_SymPool_miss.
+void BM_SymPool_load(benchmark::State& state) {
+    auto strs = strings(Num_Syms, state.range(0), state.range(1));
+    std::ostringstream oss;
+    {
+        fe::SymPool pool;
+        for (auto& str : strs) pool.sym(str);
+        pool.dump(oss);
+    }
+    auto bytes = oss.str();
+    std::vector<uint64_t> image((bytes.size() + 7) / 8); // aligned - as MMap would give us
+    std::memcpy(image.data(), bytes.data(), bytes.size());
+
+    for (auto _ : state) {
+        auto pool = std::make_unique<fe::SymPool>();
+        pool->load({(const char8_t*)image.data(), bytes.size()});
+        for (auto& str : strs) benchmark::DoNotOptimize(pool->sym(str));
+        state.PauseTiming();
+        pool.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * strs.size()));
+}
+BENCHMARK(BM_SymPool_load)->ArgNames({"min", "max"})->Args({8, 24})->Args({32, 64});
+///@}
+
+/// @name SymMap
+///@{
+/// Looks up all Sym%bols in a map of type @p M; half of them are short ones.
+template<class M> void BM_SymMap_find(benchmark::State& state) {
+    fe::SymPool pool;
+    std::vector<fe::Sym> syms;
+    for (auto& str : strings(Num_Syms, 1, 6)) syms.emplace_back(pool.sym(str));
+    for (auto& str : strings(Num_Syms, 8, 24)) syms.emplace_back(pool.sym(str));
+    M map;
+    for (size_t i = 0, e = syms.size(); i != e; ++i) map.emplace(syms[i], int(i));
+
+    for (auto _ : state)
+        for (auto sym : syms) benchmark::DoNotOptimize(map.find(sym));
+    state.SetItemsProcessed(int64_t(state.iterations() * syms.size()));
+}
+BENCHMARK_TEMPLATE(BM_SymMap_find, fe::SymMap<int>);
+BENCHMARK_TEMPLATE(BM_SymMap_find, std::unordered_map<fe::Sym, int>);
+
+void BM_SymVector_find(benchmark::State& state) {
+    fe::SymPool pool;
+    std::vector<fe::Sym> syms;
+    for (auto& str : strings(Num_Syms, 1, 6)) syms.emplace_back(pool.sym(str));
+    for (auto& str : strings(Num_Syms, 8, 24)) syms.emplace_back(pool.sym(str));
+    fe::SymVector<int> vec(pool);
+    for (size_t i = 0, e = syms.size(); i != e; ++i) vec[syms[i]] = int(i);
+
+    for (auto _ : state)
+        for (auto sym : syms) benchmark::DoNotOptimize(vec.find(sym));
+    state.SetItemsProcessed(int64_t(state.iterations() * syms.size()));
+}
+BENCHMARK(BM_SymVector_find);
+///@}
+
+/// @name Arena
+///@{
+constexpr size_t Num_Allocs = 1024;
+
+/// Argument: the size of each allocation.
+void BM_Arena_allocate(benchmark::State& state) {
+    auto size = size_t(state.range(0));
+    fe::Arena arena;
+    for (auto _ : state) {
+        for (size_t i = 0; i != Num_Allocs; ++i) benchmark::DoNotOptimize(arena.align(8).allocate(size));
+        arena.reset();
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * Num_Allocs));
+}
+BENCHMARK(BM_Arena_allocate)->Arg(8)->Arg(32)->Arg(128)->Arg(1024);
+
+void BM_malloc(benchmark::State& state) {
+    auto size = size_t(state.range(0));
+    std::vector<void*> ptrs(Num_Allocs);
+    for (auto _ : state) {
+        for (auto& ptr : ptrs) benchmark::DoNotOptimize(ptr = std::malloc(size));
+        for (auto ptr : ptrs) std::free(ptr);
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * Num_Allocs));
+}
+BENCHMARK(BM_malloc)->Arg(8)->Arg(32)->Arg(128)->Arg(1024);
+
+/// An AST node whose operands live in the same Arena - so there is no need to run its destructor.
+struct Node {
+    Node(fe::Arena& arena)
+        : ops(arena.allocator<Node*>()) {}
+
+    std::vector<Node*, fe::Arena::Allocator<Node*>> ops;
+};
+
+} // namespace
+
+template<> inline constexpr bool fe::needs_dtor<Node> = false;
+
+namespace {
+
+constexpr size_t Num_Nodes = 64 * 1024;
+
+/// Builds Num_Nodes Node%s via @p mk and reports the time it takes to tear them down again.
+/// This is timed manually: Tearing down an Arena that owns its Node%s takes far less than Pause/ResumeTiming itself.
+template<class P, class F> void tear_down(benchmark::State& state, F mk) {
+    for (auto _ : state) {
+        auto arena = std::make_unique<fe::Arena>();
+        auto nodes = std::make_unique<std::vector<P>>();
+        for (size_t i = 0; i != Num_Nodes; ++i) nodes->emplace_back(mk(*arena));
+        auto start = std::chrono::steady_clock::now();
+        nodes.reset();
+        arena.reset();
+        state.SetIterationTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * Num_Nodes));
+}
+
+/// Tears down Num_Nodes Node%s - each held by an Arena::Ptr.
+void BM_Arena_mk(benchmark::State& state) {
+    tear_down<fe::Arena::Ptr<Node>>(state, [](fe::Arena& arena) { return arena.mk<Node>(arena); });
+}
+BENCHMARK(BM_Arena_mk)->UseManualTime();
+
+/// Same as above but the Arena owns the Node%s: Tearing down is merely releasing the pages.
+void BM_Arena_create(benchmark::State& state) {
+    tear_down<Node*>(state, [](fe::Arena& arena) { return arena.create<Node>(arena); });
+}
+BENCHMARK(BM_Arena_create)->UseManualTime();
+///@}
+
+/// @name format
+///@{
+/// Formats Loc via fe::ostream_formatter - i.e. the way fe did it before it had native `std::formatter`s.
+struct Streamed {
+    fe::Loc loc;
+    friend std::ostream& operator<<(std::ostream& os, Streamed s) { return os << s.loc; }
+};
+
+} // namespace
+
+template<> struct std::formatter<Streamed> : fe::ostream_formatter {};
+
+namespace {
+
+/// Mimics a diagnostic with a Loc%ation and a Sym%bol.
+template<class L> void BM_format(benchmark::State& state) {
+    std::filesystem::path path("some/dir/file.let");
+    fe::SymPool pool;
+    auto loc = fe::Loc(&path, {12, 34}, {12, 56});
+    auto sym = pool.sym("identifier");
+    std::string buf;
+    for (auto _ : state) {
+        buf.clear();
+        std::format_to(std::back_inserter(buf), "{}: unknown identifier '{}'", L{loc}, sym);
+        benchmark::DoNotOptimize(buf.data());
+    }
+    state.SetItemsProcessed(int64_t(state.iterations()));
+}
+BENCHMARK_TEMPLATE(BM_format, fe::Loc);
+BENCHMARK_TEMPLATE(BM_format, Streamed);
+///@}
+
+/// @name Ring
+///@{
+/// Mimics Lexer::next: put one element and peek at the whole lookahead.
+template<size_t K> void BM_Ring(benchmark::State& state) {
+    fe::Ring<char32_t, K> ring;
+    for (size_t i = 0; i != K; ++i) ring[i] = 0;
+    char32_t c = 0;
+    for (auto _ : state) {
+        for (size_t n = 0; n != 1024; ++n) {
+            ring.put(c++);
+            for (size_t i = 0; i != K; ++i) benchmark::DoNotOptimize(ring[i]);
+        }
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * 1024));
+}
+BENCHMARK_TEMPLATE(BM_Ring, 1);
+BENCHMARK_TEMPLATE(BM_Ring, 2);
+BENCHMARK_TEMPLATE(BM_Ring, 3);
+BENCHMARK_TEMPLATE(BM_Ring, 4);
+
+/// Same as above but with a heavyweight element - a payload that doesn't fit into the small string buffer.
+/// With moves, the strings travel through the lookahead without any allocation besides the initial one.
+template<size_t K> void BM_RingString(benchmark::State& state) {
+    fe::Ring<std::string, K> ring;
+    auto str = std::string(64, 'x');
+    for (auto _ : state) {
+        for (size_t n = 0; n != 1024; ++n) {
+            auto front = std::move(ring.front());
+            ring.put(front.empty() ? str : std::move(front));
+            for (size_t i = 0; i != K; ++i) benchmark::DoNotOptimize(ring[i].data());
+        }
+    }
+    state.SetItemsProcessed(int64_t(state.iterations() * 1024));
+}
+BENCHMARK_TEMPLATE(BM_RingString, 1);
+BENCHMARK_TEMPLATE(BM_RingString, 2);
+BENCHMARK_TEMPLATE(BM_RingString, 3);
+BENCHMARK_TEMPLATE(BM_RingString, 4);
+///@}
+
+} // namespace
+
+int main(int argc, char** argv) {
+#ifdef FE_ABSL
+    benchmark::AddCustomContext("fe_containers", "absl");
+#else
+    benchmark::AddCustomContext("fe_containers", "std");
+#endif
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+}
@@ -1,23 +1,119 @@
 #pragma once
 
+#include <cstddef>
+
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #include "fe/assert.h"
+#include "fe/stats.h"
 
 namespace fe {
 
-/// An arena pre-allocates so-called *pages* of size Arena::page_size_.
+/// Does Arena::create (or Pool) have to run `~T()` for a @p T?
+/// By default, only if @p T is not trivially destructible.
+/// Specialize this to `false` for types whose destructors do nothing useful within an Arena - e.g. an AST node that
+/// only owns memory of the very same Arena via Arena::Allocator:
+/// ```
+/// template<> inline constexpr bool fe::needs_dtor<Node> = false;
+/// ```
+template<class T> inline constexpr bool needs_dtor = !std::is_trivially_destructible_v<T>;
+
+/// An arena pre-allocates so-called *pages* of size Arena::Config::page_size.
 /// You can use Arena::allocate to obtain memory from this.
 /// When a page runs out of memory, the next page will be (pre-)allocated.
+/// Pages may grow geometrically up to Arena::Config::max_page_size.
+/// Allocations beyond Arena::Config::large_size do not go into a page but are kept in a separate list;
+/// this way, a single big allocation neither wastes the rest of the current page nor forces a page switch.
 /// You cannot directly release memory obtained via this method.
 /// Instead, *all* memory acquired via this Arena will be released as soon as this Arena will be destroyed.
-/// As an exception, you can Arena::deallocate memory that just as been acquired.
+/// As an exception, you can Arena::deallocate everything acquired since a certain Arena::state (or Arena::Scope).
+/// Arena::reset will rewind the whole Arena but keep its pages for reuse.
+/// For short-lived Arena%s, you can furthermore share an Arena::PagePool among them.
 class Arena {
 public:
     static constexpr size_t Default_Page_Size = 1024 * 1024; ///< 1MB.
 
+    /// @name Config
+    ///@{
+    /// Tune page sizes and alignment; use Arena::reserved and Arena::used to check how well your settings work.
+    struct Config {
+        size_t page_size     = Default_Page_Size; ///< Size of the first page.
+        size_t max_page_size = Default_Page_Size; ///< Pages grow by Config::growth up to this size.
+        size_t growth        = 2;                 ///< Factor for geometric page growth.
+        /// Align pages to this.
+        /// Set this together with Config::page_size to e.g. 2MB, if you want huge pages/THP.
+        size_t page_align = alignof(std::max_align_t);
+        /// Allocations above this size go into a separate large object list; `0` means `page_size / 4`.
+        size_t large_size = 0;
+    };
+    ///@}
+
+    /// @name Page Pool
+    ///@{
+    /// A thread-safe pool of free pages of size PagePool::page_size.
+    /// An Arena constructed with a PagePool takes its pages from there and gives them back upon destruction -
+    /// instead of hitting `new`/`delete` for each page.
+    /// Use like this:
+    /// ```
+    /// Arena::PagePool pool;
+    /// while (auto request = next_request()) {
+    ///     Arena arena(pool);
+    ///     // ...
+    /// } // arena's pages go back to the pool
+    /// ```
+    /// @warning The PagePool must outlive all Arena%s using it.
+    class PagePool {
+    public:
+        PagePool(size_t page_size = Default_Page_Size, size_t page_align = alignof(std::max_align_t)) noexcept
+            : page_size_(round_up(page_size, page_align))
+            , page_align_(page_align) {}
+        PagePool(const PagePool&) = delete;
+        ~PagePool() {
+            for (auto page : free_) Arena::free(page, page_align_);
+        }
+        PagePool& operator=(PagePool) = delete;
+
+        size_t page_size() const { return page_size_; }
+        size_t page_align() const { return page_align_; }
+        /// Number of pooled pages.
+        size_t num_free() const {
+            auto lock = std::lock_guard(mutex_);
+            return free_.size();
+        }
+
+        [[nodiscard]] char* acquire() {
+            {
+                auto lock = std::lock_guard(mutex_);
+                if (!free_.empty()) {
+                    auto page = free_.back();
+                    free_.pop_back();
+                    return page;
+                }
+            }
+            return Arena::alloc(page_size_, page_align_);
+        }
+        void release(char* page) {
+            auto lock = std::lock_guard(mutex_);
+            free_.emplace_back(page);
+        }
+
+    private:
+        mutable std::mutex mutex_;
+        size_t page_size_;
+        size_t page_align_;
+        std::vector<char*> free_;
+    };
+    ///@}
+
     /// @name Allocator
     ///@{
     /// An [allocator](https://en.cppreference.com/w/cpp/named_req/Allocator) in order to use this Arena for
@@ -71,18 +167,56 @@ public:
     }
     ///@}
 
+    /// @name Owned Objects
+    ///@{
+    /// Places `new T(args...)` into this Arena, which owns the result:
+    /// If fe::needs_dtor<T>, the Arena remembers to destroy it upon Arena::reset, Arena::deallocate, or its own
+    /// destruction - in reverse order of creation.
+    /// Otherwise, nothing is recorded, and teardown is merely releasing the pages; there are no per-object
+    /// Deleter%s to run as with Arena::mk.
+    /// Use like this:
+    /// ```
+    /// auto node = arena.create<Node>(a, b, c); // Node*
+    /// ```
+    template<class T, class... Args> T* create(Args&&... args) {
+        auto ptr = new (allocate<T>(1)) T(std::forward<Args&&>(args)...);
+        if constexpr (needs_dtor<T>) dtors_.push_back({ptr, [](void* p) { static_cast<T*>(p)->~T(); }});
+        return ptr;
+    }
+
+    size_t num_dtors() const { return dtors_.size(); } ///< Number of objects that Arena::create had to record.
+    ///@}
+
     /// @name Construction/Destruction
     ///@{
+    /// All pages will be of size @p page_size.
     Arena(size_t page_size = Default_Page_Size) noexcept
-        : page_size_(page_size)
-        , index_(page_size) {}
+        : Arena(Config{.page_size = page_size, .max_page_size = page_size}) {}
+    Arena(Config config) noexcept
+        : page_size_(round_up(config.page_size, config.page_align))
+        , max_page_size_(std::max(page_size_, config.max_page_size))
+        , growth_(std::max(config.growth, size_t(1)))
+        , page_align_(config.page_align)
+        , large_size_(config.large_size ? config.large_size : page_size_ / 4)
+        , next_size_(page_size_) {}
+    /// Takes its pages from @p pool and hands them back upon destruction or Arena::trim.
+    Arena(PagePool& pool) noexcept
+        : Arena(Config{
+              .page_size = pool.page_size(), .max_page_size = pool.page_size(), .page_align = pool.page_align()}) {
+        pool_ = &pool;
+    }
     Arena(const Arena&) = delete;
     Arena(Arena&& other) noexcept
         : Arena() {
         swap(*this, other);
     }
     ~Arena() {
-        for (auto p : pages_) delete[] p;
+#ifdef FE_STATS
+        Stats::record(stats_);
+#endif
+        destroy(0);
+        for (auto page : pages_) free(page);
+        for (auto large : large_) free(large.data, page_align_);
     }
     Arena& operator=(Arena) = delete;
     ///@}
@@ -95,12 +229,22 @@ public:
 
     /// Get @p n bytes of fresh memory.
     [[nodiscard]] void* allocate(size_t num_bytes) {
-        if (index_ + num_bytes > page_size_) {
-            pages_.emplace_back(new char[std::max(page_size_, num_bytes)]);
-            index_ = 0;
+#ifdef FE_STATS
+        ++stats_.allocations;
+        stats_.used += num_bytes;
+#endif
+        if (index_ + num_bytes > limit_) {
+            if (num_bytes > large_size_) {
+#ifdef FE_STATS
+                ++stats_.large;
+                stats_.reserved += num_bytes;
+#endif
+                return large_.emplace_back(alloc(num_bytes, page_align_), num_bytes).data;
+            }
+            next_page(num_bytes);
         }
 
-        auto result = pages_.back() + index_;
+        auto result = pages_[page_ - 1].data + index_;
         index_ += num_bytes;
         return result;
     }
@@ -111,10 +255,35 @@ public:
     }
     ///@}
 
+    /// @name Statistics
+    ///@{
+    size_t num_pages() const { return pages_.size(); }
+    size_t num_large() const { return large_.size(); } ///< Number of objects in the large object list.
+    /// Bytes obtained from the system (or the PagePool) - including retained pages.
+    size_t reserved() const {
+        size_t res = 0;
+        for (auto page : pages_) res += page.size;
+        for (auto large : large_) res += large.size;
+        return res;
+    }
+    /// Bytes currently handed out via Arena::allocate - including alignment padding.
+    /// The difference to Arena::reserved is waste due to page switches and retained pages.
+    size_t used() const {
+        size_t res = index_;
+        for (size_t i = 0; i + 1 < page_; ++i) res += pages_[i].used;
+        for (auto large : large_) res += large.size;
+        return res;
+    }
+#ifdef FE_STATS
+    /// Accumulated over the whole lifetime of this Arena - only available with `FE_STATS`.
+    const Stats::Arena& stats() const { return stats_; }
+#endif
+    ///@}
+
     /// @name Deallocate
     ///@{
-    /// Tries to remove bytes again.
-    /// If this crosses a page boundary, nothing happens.
+    /// Removes all bytes allocated since @p state.
+    /// Pages that become unused are kept for later allocations.
     /// Use like this:
     /// ```
     /// auto state = arena.state();
@@ -122,23 +291,354 @@ public:
     /// if (/* I don't want that */) arena.deallocate(state);
     /// ```
     /// @warning Only use, if you really know what you are doing.
-    using State = std::pair<size_t, size_t>;
-    State state() const { return {pages_.size(), index_}; }
+    struct State {
+        size_t page, index, large, dtors;
+    };
+    State state() const { return {page_, index_, large_.size(), dtors_.size()}; }
     void deallocate(State state) {
-        if (state.first == pages_.size()) index_ = state.second; // don't care otherwise
+        destroy(state.dtors);
+        for (size_t i = state.large, e = large_.size(); i != e; ++i) free(large_[i].data, page_align_);
+        large_.erase(large_.begin() + state.large, large_.end());
+        page_  = state.page;
+        index_ = state.index;
+        limit_ = page_ == 0 ? 0 : pages_[page_ - 1].size;
+    }
+
+    /// Arena::deallocate%s everything acquired during its lifetime - even across page boundaries.
+    /// Use like this:
+    /// ```
+    /// {
+    ///     auto scope = arena.scope();
+    ///     auto tmp   = arena.allocate(n);
+    ///     // ...
+    /// } // tmp is gone
+    /// ```
+    class Scope {
+    public:
+        Scope(Arena& arena)
+            : arena_(arena)
+            , state_(arena.state()) {}
+        Scope(const Scope&) = delete;
+        ~Scope() { arena_.deallocate(state_); }
+        Scope& operator=(Scope) = delete;
+
+    private:
+        Arena& arena_;
+        State state_;
+    };
+
+    /// Factory method to build an Arena::Scope.
+    [[nodiscard]] Scope scope() { return Scope(*this); }
+
+    /// Rewinds the whole Arena - this invalidates *all* memory obtained so far - but keeps the pages for reuse.
+    void reset() { deallocate({0, 0, 0, 0}); }
+
+    /// Frees all pages that are currently not in use (or hands them back to the PagePool).
+    void trim() {
+        for (size_t i = page_, e = pages_.size(); i != e; ++i) free(pages_[i]);
+        pages_.erase(pages_.begin() + page_, pages_.end());
     }
     ///@}
 
     friend void swap(Arena& a1, Arena& a2) noexcept {
         using std::swap;
-        swap(a1.pages_, a2.pages_);
-        swap(a1.index_, a2.index_);
+        // clang-format off
+        swap(a1.pages_,         a2.pages_        );
+        swap(a1.large_,         a2.large_        );
+        swap(a1.dtors_,         a2.dtors_        );
+        swap(a1.page_size_,     a2.page_size_    );
+        swap(a1.max_page_size_, a2.max_page_size_);
+        swap(a1.growth_,        a2.growth_       );
+        swap(a1.page_align_,    a2.page_align_   );
+        swap(a1.large_size_,    a2.large_size_   );
+        swap(a1.next_size_,     a2.next_size_    );
+        swap(a1.pool_,          a2.pool_         );
+        swap(a1.page_,          a2.page_         );
+        swap(a1.index_,         a2.index_        );
+        swap(a1.limit_,         a2.limit_        );
+#ifdef FE_STATS
+        swap(a1.stats_,         a2.stats_        );
+#endif
+        // clang-format on
     }
 
 private:
-    std::vector<char*> pages_;
+    struct Page {
+        Page(char* data, size_t size)
+            : data(data)
+            , size(size) {}
+
+        char* data;
+        size_t size;
+        size_t used = 0; ///< Valid for all pages before the current one.
+    };
+
+    static constexpr size_t round_up(size_t n, size_t a) { return (n + (a - 1)) & ~(a - 1); }
+
+    static char* alloc(size_t size, size_t align) {
+        return static_cast<char*>(::operator new(size, std::align_val_t(align)));
+    }
+    static void free(char* data, size_t align) { ::operator delete(data, std::align_val_t(align)); }
+
+    /// Switches to the next retained page, if it's big enough, or slides in a fresh one otherwise.
+    void next_page(size_t num_bytes) {
+        if (page_ != 0) pages_[page_ - 1].used = index_;
+#ifdef FE_STATS
+        if (page_ != 0) stats_.waste += limit_ - std::min(index_, limit_);
+#endif
+
+        if (page_ == pages_.size() || pages_[page_].size < num_bytes) {
+            auto size = std::max(next_size_, round_up(num_bytes, page_align_));
+            auto data = pool_ && size == page_size_ ? pool_->acquire() : alloc(size, page_align_);
+#ifdef FE_STATS
+            ++stats_.pages;
+            stats_.reserved += size;
+#endif
+            pages_.insert(pages_.begin() + page_, Page(data, size));
+            next_size_ = std::min(max_page_size_, next_size_ * growth_);
+        }
+
+        limit_ = pages_[page_++].size;
+        index_ = 0;
+    }
+
+    void free(Page page) {
+        if (pool_ && page.size == page_size_)
+            pool_->release(page.data);
+        else
+            free(page.data, page_align_);
+    }
+
+    /// Runs the destructors of all objects Arena::create%d since there were @p n of them - latest first.
+    void destroy(size_t n) {
+        while (dtors_.size() > n) {
+            auto [obj, dtor] = dtors_.back();
+            dtors_.pop_back();
+            dtor(obj);
+        }
+    }
+
+    struct Dtor {
+        void* obj;
+        void (*dtor)(void*);
+    };
+
+    std::vector<Page> pages_;
+    std::vector<Page> large_;
+    std::vector<Dtor> dtors_;
     size_t page_size_;
-    size_t index_;
+    size_t max_page_size_;
+    size_t growth_;
+    size_t page_align_;
+    size_t large_size_;
+    size_t next_size_;
+    PagePool* pool_ = nullptr;
+    size_t page_    = 0; ///< Number of pages in use; the current one is `pages_[page_ - 1]`.
+    size_t index_   = 0; ///< Next free byte within the current page.
+    size_t limit_   = 0; ///< Size of the current page.
+#ifdef FE_STATS
+    Stats::Arena stats_;
+#endif
+};
+
+/// Typed object pool on top of an Arena.
+/// Pool::mk places a @p T into the Arena - or into a slot that has been given back via Pool::recycle before.
+/// The latter is handy for rewriting passes that keep replacing nodes of the same type.
+/// Destroying the Pool destroys all live objects, but only if fe::needs_dtor<T>; the memory itself goes away
+/// together with the Arena.
+/// Use like this:
+/// ```
+/// fe::Pool<Node> nodes(arena);
+/// auto node = nodes.mk(a, b, c);
+/// // ...
+/// nodes.recycle(node); // next nodes.mk reuses its slot
+/// ```
+/// @warning The Arena knows nothing about the Pool: Do not Arena::reset, Arena::deallocate, or leave an Arena::Scope
+/// behind any slot of a live Pool - otherwise, Pool::mk hands out memory that overlaps fresh allocations and ~Pool
+/// destroys objects that are long gone.
+/// Debug builds assert on this.
+template<class T> class Pool {
+public:
+    /// @name Construction/Destruction
+    ///@{
+    Pool(Arena& arena) noexcept
+        : arena_(arena) {}
+    Pool(const Pool&) = delete;
+    ~Pool() {
+        assert(sound() && "Arena has been rewound behind a slot of this Pool");
+        if constexpr (needs_dtor<T>)
+            for (auto slot : slots_)
+                if (slot->live) reinterpret_cast<T*>(slot->storage)->~T();
+    }
+    Pool& operator=(Pool) = delete;
+    ///@}
+
+    /// @name Create/Recycle
+    ///@{
+    template<class... Args> T* mk(Args&&... args) {
+        assert(sound() && "Arena has been rewound behind a slot of this Pool");
+        Slot* slot;
+        if (free_) {
+            slot  = free_;
+            free_ = next(free_);
+        } else {
+            slot = new (arena_.allocate<Slot>(1)) Slot;
+            if constexpr (needs_dtor<T>) slots_.push_back(slot);
+            auto state = arena_.state();
+            high_      = {state.page, state.index};
+        }
+        auto ptr = new (slot->storage) T(std::forward<Args&&>(args)...);
+        if constexpr (needs_dtor<T>) slot->live = true;
+        ++num_live_;
+        return ptr;
+    }
+
+    /// Destroys @p ptr - which must stem from this Pool - and keeps its slot for the next Pool::mk.
+    void recycle(T* ptr) {
+        assert(num_live_ > 0 && sound());
+        ptr->~T();
+        auto slot = reinterpret_cast<Slot*>(ptr);
+        if constexpr (needs_dtor<T>) slot->live = false;
+        new (slot->storage) Slot*(free_);
+        free_ = slot;
+        --num_live_;
+    }
+    ///@}
+
+    /// @name Getters
+    ///@{
+    Arena& arena() { return arena_; }
+    size_t num_live() const { return num_live_; }
+    size_t num_free() const {
+        size_t n = 0;
+        for (auto slot = free_; slot; slot = next(slot)) ++n;
+        return n;
+    }
+    ///@}
+
+private:
+    struct Empty {};
+
+    /// Holds either a live @p T or - if recycled - the next free Slot.
+    struct Slot {
+        alignas(T) alignas(Slot*) std::byte storage[std::max(sizeof(T), sizeof(Slot*))];
+        [[no_unique_address]] std::conditional_t<needs_dtor<T>, bool, Empty> live;
+    };
+
+    static Slot* next(Slot* slot) { return *std::launder(reinterpret_cast<Slot**>(slot->storage)); }
+
+    /// Is the Arena still in front of the end of our last Slot? A best-effort check for the warning above.
+    bool sound() const {
+        auto state = arena_.state();
+        return std::pair(state.page, state.index) >= high_;
+    }
+
+    Arena& arena_;
+    Slot* free_      = nullptr;
+    size_t num_live_ = 0;
+    std::pair<size_t, size_t> high_; ///< Arena::State::page and Arena::State::index right behind our last Slot.
+    std::vector<Slot*> slots_; ///< All Slot%s ever handed out - only needed if fe::needs_dtor<T>.
+};
+
+/// Hands out one Arena per thread, so you can allocate - say AST nodes - from many threads in parallel.
+/// ConcurrentArena::local is the calling thread's Arena: Obtaining it is a `thread_local` lookup without any atomics
+/// on the fast path; from there on, Arena::allocate, Arena::Allocator, and Arena::mk work as usual.
+/// All per-thread Arena%s are owned by this ConcurrentArena, i.e. they die in one go together with it.
+/// Use like this:
+/// ```
+/// fe::ConcurrentArena arena;
+/// // in each worker:
+/// std::vector<Foo*, fe::Arena::Allocator<Foo*>> foos(arena.allocator<Foo*>());
+/// auto ptr = arena.mk<Foo>(a, b, c);
+/// ```
+/// @warning An Arena::Allocator obtained by one thread must not be used by another thread at the same time.
+class ConcurrentArena {
+public:
+    /// Number of ConcurrentArena%s whose per-thread Arena each thread remembers - see ConcurrentArena::local.
+    static constexpr size_t Num_Cached = 4;
+
+    /// @name Construction/Destruction
+    ///@{
+    ConcurrentArena(Arena::Config config = {}) noexcept
+        : id_(next_id())
+        , config_(config) {}
+    /// All per-thread Arena%s take their pages from @p pool.
+    ConcurrentArena(Arena::PagePool& pool) noexcept
+        : id_(next_id())
+        , pool_(&pool) {}
+    ConcurrentArena(const ConcurrentArena&) = delete;
+    ConcurrentArena& operator=(ConcurrentArena) = delete;
+    ///@}
+
+    /// The Arena of the calling thread; it is created on first use.
+    /// Each thread remembers the Arena%s of the ConcurrentArena::Num_Cached ConcurrentArena%s it used most recently,
+    /// so alternating between a few of them - e.g. Batch::Job::arena and your own one - stays on the fast path.
+    Arena& local() {
+        thread_local std::array<Cache, Num_Cached> cache;
+        if (cache.front().id == id_) return *cache.front().arena;
+        auto i = std::find_if(cache.begin() + 1, cache.end(), [this](const Cache& c) { return c.id == id_; });
+        if (i == cache.end()) *--i = {id_, &lookup()}; // evict the least recently used one
+        std::rotate(cache.begin(), i, i + 1);
+        return *cache.front().arena;
+    }
+
+    /// @name Forwarding to ConcurrentArena::local
+    ///@{
+    [[nodiscard]] void* allocate(size_t num_bytes) { return local().allocate(num_bytes); }
+    template<class T> [[nodiscard]] T* allocate(size_t num_elems) { return local().allocate<T>(num_elems); }
+    template<class T> Arena::Allocator<T> allocator() { return local().allocator<T>(); }
+    template<class T, class... Args> Arena::Ptr<T> mk(Args&&... args) {
+        return local().mk<T>(std::forward<Args&&>(args)...);
+    }
+    ///@}
+
+    /// @name Whole ConcurrentArena
+    ///@{
+    /// @warning Only invoke these while no other thread is allocating.
+    size_t num_arenas() const {
+        auto lock = std::lock_guard(mutex_);
+        return arenas_.size();
+    }
+    size_t reserved() const { return sum(&Arena::reserved); }
+    size_t used() const { return sum(&Arena::used); }
+    /// Arena::reset%s all per-thread Arena%s.
+    void reset() {
+        auto lock = std::lock_guard(mutex_);
+        for (auto& [_, arena] : arenas_) arena->reset();
+    }
+    ///@}
+
+private:
+    struct Cache {
+        uint64_t id  = 0;
+        Arena* arena = nullptr;
+    };
+
+    /// Unique for each ConcurrentArena ever - so a stale Cache never matches a new ConcurrentArena at the same address.
+    static uint64_t next_id() {
+        static std::atomic<uint64_t> counter = 0;
+        return ++counter;
+    }
+
+    Arena& lookup() {
+        auto lock  = std::lock_guard(mutex_);
+        auto& slot = arenas_[std::this_thread::get_id()];
+        if (!slot) slot = pool_ ? std::make_unique<Arena>(*pool_) : std::make_unique<Arena>(config_);
+        return *slot;
+    }
+
+    size_t sum(size_t (Arena::*f)() const) const {
+        auto lock  = std::lock_guard(mutex_);
+        size_t res = 0;
+        for (auto& [_, arena] : arenas_) res += (*arena.*f)();
+        return res;
+    }
+
+    uint64_t id_;
+    Arena::Config config_;
+    Arena::PagePool* pool_ = nullptr;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::thread::id, std::unique_ptr<Arena>> arenas_;
 };
 
 } // namespace fe
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "fe/arena.h"
+#include "fe/diag.h"
+#include "fe/format.h"
+#include "fe/sym.h"
+
+namespace fe {
+
+/// Runs a frontend - i.e. your lex & parse callback - over many files in parallel.
+/// Files are distributed among Batch::Config::num_threads workers; a worker that runs out of files steals from the
+/// others, so a few huge files do not stall the rest.
+/// All workers share one ConcurrentSymPool; each worker allocates from its own Arena via ConcurrentArena.
+/// Diagnostics are buffered per file and emitted in the order of the input files afterwards - just as the results.
+/// Thus, the output is deterministic regardless of the scheduling.
+/// Use like this:
+/// ```
+/// fe::ConcurrentSymPool syms;
+/// fe::Batch batch(syms);
+/// auto asts = batch.run(paths, [](fe::Batch::Job& job) {
+///     fe::MMap mmap(job.path());
+///     if (!mmap) {
+///         job.err({}, "cannot read file '{}'", job.path().string());
+///         return AST();
+///     }
+///     Parser parser(job, mmap.span(), &job.path()); // use Job instead of Driver
+///     return parser.parse_prog();
+/// });
+/// if (batch.num_errors() != 0) return EXIT_FAILURE;
+/// ```
+class Batch {
+public:
+    struct Config {
+        size_t num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+        Arena::Config arena;
+    };
+
+    /// What your callback gets for each file - it offers the same interface as Driver for interning and diagnostics.
+    class Job {
+    public:
+        /// @name Getters
+        ///@{
+        const std::filesystem::path& path() const { return path_; }
+        size_t index() const { return index_; } ///< Position of Job::path within the list passed to Batch::run.
+        Arena& arena() { return batch_.arena_.local(); } ///< The calling worker's Arena.
+        ///@}
+
+        /// @name sym
+        ///@{
+        Sym sym(std::string_view s) { return batch_.syms_.sym(s); }
+        Sym sym(const std::string& s) { return batch_.syms_.sym(s); }
+        Sym sym(const char* s) { return batch_.syms_.sym(s); }
+        ///@}
+
+        /// @name Diagnostics
+        ///@{
+        template<class... Args> void note(Loc loc, std::format_string<Args...> fmt, Args&&... args) {
+            emit(Diag::Kind::Note, loc, fmt, std::forward<Args&&>(args)...);
+        }
+        template<class... Args> void warn(Loc loc, std::format_string<Args...> fmt, Args&&... args) {
+            ++num_warnings_;
+            emit(Diag::Kind::Warn, loc, fmt, std::forward<Args&&>(args)...);
+        }
+        template<class... Args> void err(Loc loc, std::format_string<Args...> fmt, Args&&... args) {
+            ++num_errors_;
+            emit(Diag::Kind::Err, loc, fmt, std::forward<Args&&>(args)...);
+        }
+
+        unsigned num_errors() const { return num_errors_; }
+        unsigned num_warnings() const { return num_warnings_; }
+        ///@}
+
+    private:
+        Job(Batch& batch, const std::filesystem::path& path, size_t index)
+            : batch_(batch)
+            , path_(path)
+            , index_(index) {}
+
+        template<class... Args> void emit(Diag::Kind kind, Loc loc, std::format_string<Args...> fmt, Args&&... args) {
+            std::string msg;
+            std::format_to(std::back_inserter(msg), fmt, std::forward<Args&&>(args)...);
+            diags_.push_back({kind, loc, std::move(msg)});
+        }
+
+        Batch& batch_;
+        const std::filesystem::path& path_;
+        size_t index_;
+        unsigned num_errors_   = 0;
+        unsigned num_warnings_ = 0;
+        std::vector<Diag> diags_; ///< Only touched by the worker that runs this Job.
+
+        friend class Batch;
+    };
+
+    /// @name Construction
+    ///@{
+    Batch(ConcurrentSymPool& syms)
+        : Batch(syms, Config()) {}
+    /// Diagnostics go to @p sink - a BufferedSink for `std::cerr`, if `nullptr`.
+    Batch(ConcurrentSymPool& syms, Config config, Sink* sink = nullptr)
+        : syms_(syms)
+        , arena_(config.arena)
+        , num_threads_(std::max(config.num_threads, size_t(1)))
+        , sink_(sink ? sink : &cerr_) {}
+    Batch(const Batch&) = delete;
+    Batch& operator=(const Batch&) = delete;
+    ///@}
+
+    /// Invokes @p f with a Batch::Job for each of the @p paths and waits until all are done.
+    /// If @p f throws for some Job%s, the remaining ones still run; after all diagnostics have been emitted, the
+    /// exception of the first such Job - in the order of @p paths - is rethrown.
+    /// @returns the results of @p f in the order of @p paths.
+    template<class F> auto run(std::span<const std::filesystem::path> paths, F&& f) {
+        using R = std::invoke_result_t<F&, Job&>;
+        constexpr bool Void = std::is_void_v<R>;
+        using Res = std::conditional_t<Void, char, R>;
+
+        auto n = paths.size();
+        std::vector<std::optional<Job>> jobs(n);
+        std::vector<std::optional<Res>> results(Void ? 0 : n); // not std::vector<bool> - its bits would race
+        std::vector<std::exception_ptr> exceptions(n);
+
+        // hand out contiguous chunks so neighboring files - that often are of similar size - stay together
+        auto num_workers = std::min(num_threads_, std::max(n, size_t(1)));
+        auto queues      = std::make_unique<Queue[]>(num_workers);
+        for (size_t w = 0; w != num_workers; ++w)
+            for (size_t i = w * n / num_workers, e = (w + 1) * n / num_workers; i != e; ++i) queues[w].jobs.push_back(i);
+
+        auto work = [&](size_t w) {
+            while (auto i = pop(queues.get(), num_workers, w)) {
+                auto& job = jobs[*i].emplace(Job(*this, paths[*i], *i));
+                try {
+                    if constexpr (Void)
+                        f(job);
+                    else
+                        results[*i].emplace(f(job));
+                } catch (...) {
+                    exceptions[*i] = std::current_exception(); // an escaping exception would std::terminate
+                }
+            }
+        };
+
+        if (num_workers == 1) {
+            work(0);
+        } else {
+            std::vector<std::jthread> workers;
+            for (size_t w = 0; w != num_workers; ++w) workers.emplace_back(work, w);
+        } // join
+
+        // merge in deterministic order
+        for (auto& job : jobs) {
+            num_errors_ += job->num_errors_;
+            num_warnings_ += job->num_warnings_;
+            for (auto& diag : job->diags_) sink_->emit(diag.kind, diag.loc, diag.msg);
+        }
+        sink_->flush();
+
+        for (auto& exception : exceptions)
+            if (exception) std::rethrow_exception(exception);
+
+        if constexpr (!Void) {
+            std::vector<R> res;
+            res.reserve(n);
+            for (auto& result : results) res.emplace_back(std::move(*result));
+            return res;
+        }
+    }
+
+    /// @name Getters
+    ///@{
+    ConcurrentSymPool& syms() { return syms_; }
+    ConcurrentArena& arena() { return arena_; } ///< Owns all memory that Job::arena handed out.
+    size_t num_threads() const { return num_threads_; }
+    /// Accumulated over all Batch::run%s.
+    unsigned num_errors() const { return num_errors_; }
+    unsigned num_warnings() const { return num_warnings_; }
+    ///@}
+
+private:
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        std::deque<size_t> jobs;
+    };
+
+    /// Pops from the front of worker @p w's own Queue; otherwise, steals from the back of another one.
+    static std::optional<size_t> pop(Queue* queues, size_t num_workers, size_t w) {
+        for (size_t k = 0; k != num_workers; ++k) {
+            auto& queue = queues[(w + k) % num_workers];
+            auto lock   = std::lock_guard(queue.mutex);
+            if (queue.jobs.empty()) continue;
+            size_t i;
+            if (k == 0) {
+                i = queue.jobs.front();
+                queue.jobs.pop_front();
+            } else {
+                i = queue.jobs.back();
+                queue.jobs.pop_back();
+            }
+            return i;
+        }
+        return {}; // nothing left anywhere - no new Jobs show up, so we are done
+    }
+
+    ConcurrentSymPool& syms_;
+    ConcurrentArena arena_;
+    size_t num_threads_;
+    BufferedSink cerr_;
+    Sink* sink_;
+    unsigned num_errors_   = 0;
+    unsigned num_warnings_ = 0;
+};
+
+} // namespace fe
@@ -1,5 +1,12 @@
 #pragma once
 
+#include <cstddef>
+
+#include <algorithm>
+#include <array>
+#include <type_traits>
+#include <utility>
+
 #include "fe/assert.h"
 
 namespace fe {
@@ -10,6 +17,45 @@ concept Nodeable = requires(T n) {
     n.node();
 };
 
+/// Class @p T - typically an abstract one - covers all node kinds in the closed interval
+/// [`T::First_Node`, `T::Last_Node`].
+/// Number your node kinds in a pre-order traversal of your class hierarchy, and each subtree is such an interval:
+/// ```
+/// enum class Node { Lit, Var, Add, Mul, Let, Fun };
+/// //                ^-------- Expr ---------^ ^-Decl-^
+/// //                          ^-BinExpr-^
+/// ```
+/// As `First_Node`/`Last_Node` are inherited, each class opts in on its own with `using Node_Range_Of = T;`.
+/// A subclass that doesn't - and thus doesn't cover its parent's range - falls back to `dynamic_cast`:
+/// ```
+/// struct BinExpr : Expr {
+///     static constexpr auto First_Node = Node::Add, Last_Node = Node::Mul;
+///     using Node_Range_Of = BinExpr;
+/// };
+/// ```
+template<class T>
+concept NodeRangeable = requires(T n) {
+    T::First_Node;
+    T::Last_Node;
+    n.node();
+    requires std::is_same_v<typename T::Node_Range_Of, T>;
+};
+
+namespace detail {
+/// Node kind as unsigned number - no matter whether it's a (scoped) `enum` or an integer.
+template<class K> constexpr auto node2num(K k) {
+    if constexpr (std::is_enum_v<K>)
+        return std::make_unsigned_t<std::underlying_type_t<K>>(k);
+    else
+        return std::make_unsigned_t<K>(k);
+}
+} // namespace detail
+
+/// Bundles several lambdas to one overloaded function object - e.g. for RuntimeCast::visit.
+template<class... Fs> struct Overload : Fs... {
+    using Fs::operator()...;
+};
+
 /// Inherit from this class using [CRTP](https://en.wikipedia.org/wiki/Curiously_recurring_template_pattern),
 /// for some nice `dynamic_cast`-style wrappers.
 template<class B>
@@ -20,11 +66,19 @@ public:
     template<class T> T* as() { assert(isa<T>()); return  static_cast<T*>(this); }
 
     /// `dynamic_cast`.
-    /// If @p T isa fe::Nodeable, it will use `node()`, otherwise a `dynamic_cast`.
+    /// If @p T isa fe::Nodeable, it will compare with `node()`.
+    /// Otherwise, if @p T isa fe::NodeRangeable, it will check whether `node()` is within @p T's range.
+    /// Otherwise, it does a `dynamic_cast`.
     template<class T>
     T* isa() {
         if constexpr (Nodeable<T>) {
             return static_cast<B*>(this)->node() == T::Node ? static_cast<T*>(this) : nullptr;
+        } else if constexpr (NodeRangeable<T>) {
+            using N = decltype(detail::node2num(T::First_Node));
+            constexpr N first = detail::node2num(T::First_Node), last = detail::node2num(T::Last_Node);
+            static_assert(first <= last);
+            auto n = N(detail::node2num(static_cast<B*>(this)->node()) - first); // wraps around if below first
+            return n <= N(last - first) ? static_cast<T*>(this) : nullptr;
         } else {
             return dynamic_cast<T*>(static_cast<B*>(this));
         }
@@ -37,6 +91,43 @@ public:
     template<class T         > const T* isa() const { return const_cast<RuntimeCast*>(this)->template isa<T   >(); } ///< `const` version.
     template<class T, class U> const B* isa() const { return const_cast<RuntimeCast*>(this)->template isa<T, U>(); } ///< `const` version.
     // clang-format on
+
+    /// Invokes @p f with `this` cast to the one among the fe::Nodeable @p Ts whose `T::Node` matches `node()` -
+    /// or with `B*` if there is none.
+    /// Instead of a chain of RuntimeCast::isa tests, this is a single indirect call through a table indexed by
+    /// `node()`.
+    /// Use like this:
+    /// ```
+    /// auto str = expr->visit<Lit, Var>(fe::Overload{
+    ///     [](Lit* lit) { return std::to_string(lit->val); },
+    ///     [](Var* var) { return var->sym.str(); },
+    ///     [](Expr*) { return "<expr>"s; }, // everything else
+    /// });
+    /// ```
+    template<class... Ts, class F> decltype(auto) visit(F&& f) {
+        return dispatch<B, Ts...>(static_cast<B*>(this), f);
+    }
+    template<class... Ts, class F> decltype(auto) visit(F&& f) const {
+        return dispatch<const B, const Ts...>(static_cast<const B*>(this), f);
+    }
+
+private:
+    template<class P, class... Ts, class F> static decltype(auto) dispatch(P* self, F& f) {
+        static_assert((Nodeable<std::remove_const_t<Ts>> && ...), "visit only dispatches on leaves");
+        using R          = std::common_type_t<std::invoke_result_t<F&, P*>, std::invoke_result_t<F&, Ts*>...>;
+        using Fn         = R (*)(P*, F&);
+        constexpr auto N = std::max({size_t(0), size_t(detail::node2num(Ts::Node) + 1)...});
+
+        static constexpr auto table = [] {
+            std::array<Fn, N> table;
+            table.fill([](P* p, F& f) -> R { return f(p); });
+            ((table[detail::node2num(Ts::Node)] = [](P* p, F& f) -> R { return f(static_cast<Ts*>(p)); }), ...);
+            return table;
+        }();
+
+        auto n = size_t(detail::node2num(self->node()));
+        return n < N ? table[n](self, f) : R(f(self));
+    }
 };
 
 } // namespace fe
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <cstdint>
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "fe/format.h"
+#include "fe/loc.h"
+
+namespace fe {
+
+/// A single diagnostic as issued by Driver::note, Driver::warn, or Driver::err.
+struct Diag {
+    enum class Kind : uint8_t { Note, Warn, Err };
+
+    static constexpr std::string_view str(Kind kind) {
+        switch (kind) {
+            case Kind::Note: return "note";
+            case Kind::Warn: return "warning";
+            default: return "error";
+        }
+    }
+
+    Kind kind;
+    Loc loc;
+    std::string msg;
+
+    /// Prints like `file:1:2-3: error: <msg>`.
+    friend std::ostream& operator<<(std::ostream& os, const Diag& diag) {
+        return os << diag.loc << ": " << str(diag.kind) << ": " << diag.msg;
+    }
+};
+
+/// Receives the diagnostics of a Driver - hook in your own via Driver::set_sink.
+/// @note Sink::emit may be invoked from several threads at once.
+class Sink {
+public:
+    virtual ~Sink() = default;
+
+    /// @p msg is only valid during this call.
+    virtual void emit(Diag::Kind kind, Loc loc, std::string_view msg) = 0;
+    virtual void flush() {}
+};
+
+/// The default Sink: Renders the diagnostics into a buffer which is written to @p os in batches of @p batch_size
+/// bytes - instead of one flush per diagnostic as `std::endl` would do.
+/// Sink::flush or the destructor emit the rest.
+/// If your tool bails out via `std::exit` or `std::abort` right after an error, either Sink::flush before or pass
+/// @p flush_errors: Then, each error flushes right away - together with the notes and warnings buffered before it.
+/// @note Until then, buffered diagnostics may appear after other output you wrote to @p os directly.
+class BufferedSink : public Sink {
+public:
+    static constexpr size_t Default_Batch_Size = 16 * 1024;
+
+    BufferedSink(std::ostream& os = std::cerr, size_t batch_size = Default_Batch_Size, bool flush_errors = false)
+        : os_(os)
+        , batch_size_(batch_size)
+        , flush_errors_(flush_errors) {}
+    ~BufferedSink() override { flush(); }
+
+    void emit(Diag::Kind kind, Loc loc, std::string_view msg) override {
+        thread_local std::string line; // render outside of the lock
+        line.clear();
+        std::format_to(std::back_inserter(line), "{}: {}: {}\n", loc, Diag::str(kind), msg);
+
+        auto lock = std::lock_guard(mutex_);
+        buffer_ += line;
+        if (flush_errors_ && kind == Diag::Kind::Err) {
+            write();
+            os_.flush();
+        } else if (buffer_.size() >= batch_size_) {
+            write();
+        }
+    }
+
+    void flush() override {
+        auto lock = std::lock_guard(mutex_);
+        write();
+        os_.flush();
+    }
+
+private:
+    void write() {
+        os_.write(buffer_.data(), buffer_.size());
+        buffer_.clear();
+    }
+
+    std::ostream& os_;
+    size_t batch_size_;
+    bool flush_errors_;
+    std::mutex mutex_;
+    std::string buffer_;
+};
+
+/// Keeps all diagnostics in memory - e.g. for a language server or for testing.
+class Collector : public Sink {
+public:
+    void emit(Diag::Kind kind, Loc loc, std::string_view msg) override {
+        auto lock = std::lock_guard(mutex_);
+        diags_.push_back({kind, loc, std::string(msg)});
+    }
+
+    /// @name Access
+    ///@{
+    std::vector<Diag> diags() const {
+        auto lock = std::lock_guard(mutex_);
+        return diags_;
+    }
+    /// Moves out all diagnostics collected so far.
+    std::vector<Diag> take() {
+        auto lock = std::lock_guard(mutex_);
+        return std::exchange(diags_, {});
+    }
+    ///@}
+
+    /// Serializes all diagnostics as JSON array of `{"kind", "file", "begin": [row, col], "finis": [row, col], "msg"}`.
+    void json(std::ostream& os) const {
+        auto lock = std::lock_guard(mutex_);
+        auto str  = [&os](std::string_view s) {
+            os << '"';
+            for (auto c : s) {
+                if (c == '"' || c == '\\')
+                    os << '\\' << c;
+                else if (c == '\n')
+                    os << "\\n";
+                else if ((unsigned char)c < 0x20)
+                    os << "\\u00" << "0123456789abcdef"[c >> 4] << "0123456789abcdef"[c & 0xf];
+                else
+                    os << c;
+            }
+            os << '"';
+        };
+
+        os << '[';
+        for (auto sep = ""; auto& diag : diags_) {
+            os << sep << "{\"kind\": ";
+            str(Diag::str(diag.kind));
+            os << ", \"file\": ";
+            str(diag.loc.path ? diag.loc.path->string() : std::string());
+            os << ", \"begin\": [" << diag.loc.begin.row << ", " << diag.loc.begin.col << ']';
+            os << ", \"finis\": [" << diag.loc.finis.row << ", " << diag.loc.finis.col << ']';
+            os << ", \"msg\": ";
+            str(diag.msg);
+            os << '}';
+            sep = ", ";
+        }
+        os << ']';
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<Diag> diags_;
+};
+
+/// Forwards to another Sink but drops exact duplicates and anything beyond @p max diagnostics per Diag::Kind.
+/// Use like this:
+/// ```
+/// fe::Filter filter(driver.sink(), 100);
+/// driver.set_sink(filter);
+/// ```
+class Filter : public Sink {
+public:
+    Filter(Sink& sink, size_t max = std::numeric_limits<size_t>::max(), bool dedup = true)
+        : sink_(sink)
+        , max_(max)
+        , dedup_(dedup) {}
+
+    void emit(Diag::Kind kind, Loc loc, std::string_view msg) override {
+        {
+            auto lock = std::lock_guard(mutex_);
+            if (counts_[size_t(kind)] == max_ || (dedup_ && !seen_.emplace(key(kind, loc, msg)).second)) {
+                ++num_dropped_;
+                return;
+            }
+            ++counts_[size_t(kind)];
+        }
+        sink_.emit(kind, loc, msg);
+    }
+
+    void flush() override { sink_.flush(); }
+
+    size_t num_dropped() const { return num_dropped_; }
+
+private:
+    static std::string key(Diag::Kind kind, Loc loc, std::string_view msg) {
+        auto path = std::bit_cast<uintptr_t>(loc.path); // Loc::path is compared via pointer anyway
+        auto pos  = std::array<uint16_t, 4>{loc.begin.row, loc.begin.col, loc.finis.row, loc.finis.col};
+        std::string res((const char*)&path, sizeof(path));
+        res.append((const char*)pos.data(), sizeof(pos));
+        res += char(kind);
+        res += msg;
+        return res;
+    }
+
+    Sink& sink_;
+    size_t max_;
+    bool dedup_;
+    std::mutex mutex_;
+    std::array<size_t, 3> counts_ = {};
+    std::unordered_set<std::string> seen_;
+    std::atomic<size_t> num_dropped_ = 0;
+};
+
+} // namespace fe
@@ -1,10 +1,15 @@
 #pragma once
 
-#include <sstream>
+#include <atomic>
+#include <iostream>
+#include <iterator>
+#include <string>
 #include <string_view>
 
+#include <fe/diag.h>
 #include <fe/format.h>
 #include <fe/loc.h>
+#include <fe/stats.h>
 #include <fe/sym.h>
 
 namespace fe {
@@ -14,27 +19,83 @@ namespace fe {
 /// Right now, it manages a SymPool (by inherting from it) and offers `std::format`-based diagnostics.
 struct Driver : public SymPool {
 public:
+    /// @name Construction
+    ///@{
+    Driver() = default;
+    /// Takes over the SymPool and the counters of @p other, which is flushed.
+    /// A Sink installed via Driver::set_sink carries over; otherwise, the new Driver gets its own BufferedSink.
+    Driver(Driver&& other)
+        : SymPool(std::move(other))
+        , num_errors_(other.num_errors_.load())
+        , num_warnings_(other.num_warnings_.load())
+        , sink_(other.sink_ == &other.cerr_ ? &cerr_ : other.sink_) {
+        other.flush();
+    }
+    ///@}
+
     /// @name Diagnostics
     ///@{
-    template<class... Args> static void note(Loc loc, std::format_string<Args...> fmt, Args&&... args) {
-        std::cerr << loc << ": note: " << std::format(fmt, std::forward<Args&&>(args)...) << std::endl;
+    /// These are thread-safe and go to Driver::sink - a BufferedSink for `std::cerr` by default.
+    /// Hence, Driver::note needs a Driver just like Driver::warn and Driver::err.
+    template<class... Args> void note(Loc loc, std::format_string<Args...> fmt, Args&&... args) {
+        emit(Diag::Kind::Note, loc, fmt, std::forward<Args&&>(args)...);
     }
     template<class... Args> void warn(Loc loc, std::format_string<Args...> fmt, Args&&... args) {
         ++num_warnings_;
-        std::cerr << loc << ": warning: " << std::format(fmt, std::forward<Args&&>(args)...) << std::endl;
+        emit(Diag::Kind::Warn, loc, fmt, std::forward<Args&&>(args)...);
     }
     template<class... Args> void err(Loc loc, std::format_string<Args...> fmt, Args&&... args) {
         ++num_errors_;
-        std::cerr << loc << ": error: " << std::format(fmt, std::forward<Args&&>(args)...) << std::endl;
+        emit(Diag::Kind::Err, loc, fmt, std::forward<Args&&>(args)...);
     }
 
     unsigned num_errors() const { return num_errors_; }
     unsigned num_warnings() const { return num_warnings_; }
     ///@}
 
+    /// @name Sink
+    ///@{
+    Sink& sink() { return *sink_; }
+    /// Redirects all further diagnostics to @p sink which must outlive this Driver (or the next Driver::set_sink).
+    /// Flushes the previous Sink.
+    /// @warning Unlike the diagnostics themselves, this is *not* thread-safe.
+    void set_sink(Sink& sink) {
+        sink_->flush();
+        sink_ = &sink;
+    }
+    void flush() { sink_->flush(); }
+    ///@}
+
+    /// @name Statistics
+    ///@{
+    /// All fe::Stats recorded so far - i.e. Stats::global plus the Sym and Arena counters of this Driver's SymPool.
+    /// Everything is 0 unless fe is built with `FE_STATS`.
+    /// @warning Stats::global is process-wide and only filled when a Lexer, Parser, or Arena is destroyed:
+    /// It mixes in whatever *every* Driver of the process has left behind so far - but not what is still alive.
+    /// If you run several Driver%s, call Stats::clear_global before the run you care about.
+    Stats stats() const {
+        auto res = Stats::global();
+#ifdef FE_STATS
+        res.sym += SymPool::stats();
+        res.arena += SymPool::arena_stats();
+#endif
+        return res;
+    }
+    void dump_stats(std::ostream& os = std::cerr) const { stats().dump(os); }
+    ///@}
+
 private:
-    unsigned num_errors_   = 0;
-    unsigned num_warnings_ = 0;
+    template<class... Args> void emit(Diag::Kind kind, Loc loc, std::format_string<Args...> fmt, Args&&... args) {
+        thread_local std::string msg; // reuse buffer
+        msg.clear();
+        std::format_to(std::back_inserter(msg), fmt, std::forward<Args&&>(args)...);
+        sink_->emit(kind, loc, msg);
+    }
+
+    std::atomic<unsigned> num_errors_   = 0;
+    std::atomic<unsigned> num_warnings_ = 0;
+    BufferedSink cerr_;
+    Sink* sink_ = &cerr_;
 };
 
 } // namespace fe
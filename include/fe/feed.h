@@ -0,0 +1,121 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "fe/assert.h"
+
+namespace fe {
+
+/// Push-style input for a Lexer: Instead of blocking on a `std::istream`, you Feed::push chunks of bytes as they
+/// arrive - e.g. from a socket or a REPL - and pull all tokens that are complete by now via Feed::next.
+/// Wraps a Lexer @p L over a growing buffer, which is Lexer::partial until Feed::close.
+/// If @p L runs into the end of the buffer while lexing a token - see Lexer::starved -, Feed::next rewinds to the
+/// Lexer::Checkpoint in front of the token and yields `std::nullopt`, i.e. "need more input".
+/// UTF-8 sequences split across chunks are simply taken care of this way.
+/// Use like this:
+/// ```
+/// fe::Feed<Lexer> feed([](const Tok& tok) { return tok.tag() == Tok::Tag::T_EoF; },
+///                      [&](std::span<const char8_t> buffer) { return Lexer(driver, buffer, &path); });
+/// while (auto chunk = socket.read()) {
+///     feed.push(*chunk);
+///     while (auto tok = feed.next()) handle(*tok);
+/// }
+/// feed.close();
+/// while (auto tok = feed.next()) handle(*tok); // the rest - up to and including the EoF token
+/// ```
+/// @note A token that touches the end of a chunk is lexed again once more input arrives.
+/// Thus, @p L should not report errors at utf8::EoF - e.g. an unterminated comment - while Lexer::starved.
+/// Similarly, a diagnostic your Lexer::lex issues before it starves within the very same invocation is issued again.
+/// @note Bytes in front of the current token are dropped from time to time;
+/// add Feed::base to Lexer::offset for an offset within the whole input.
+template<class L> class Feed {
+public:
+    using Tok = std::invoke_result_t<decltype(&L::lex), L&>;
+
+    /// Only drop consumed bytes if there are at least that many.
+    static constexpr size_t Min_Drop = 64 * 1024;
+
+    /// @name Construction
+    ///@{
+    /// @p eof identifies the last token; @p mk builds the @p L from a `std::span<const char8_t>`.
+    template<class F>
+    Feed(std::function<bool(const Tok&)> eof, F&& mk)
+        : eof_(std::move(eof))
+        , lexer_(mk(std::span<const char8_t>(buffer_))) {
+        lexer_.partial(true);
+        lexer_.restore(lexer_.checkpoint(), buffer_);
+    }
+    Feed(const Feed&) = delete;
+    Feed& operator=(Feed) = delete;
+    ///@}
+
+    /// @name Push
+    ///@{
+    /// Appends @p chunk to the input.
+    void push(std::span<const char8_t> chunk) {
+        assert(!closed_ && "input already closed");
+        auto checkpoint = lexer_.checkpoint();
+        if (checkpoint.offset >= Min_Drop && 2 * checkpoint.offset >= buffer_.size()) {
+            buffer_.erase(buffer_.begin(), buffer_.begin() + checkpoint.offset);
+            base_ += checkpoint.offset;
+            checkpoint.offset = 0;
+        }
+        buffer_.insert(buffer_.end(), chunk.begin(), chunk.end());
+        lexer_.restore(checkpoint, buffer_, base_ == 0);
+    }
+    void push(std::string_view chunk) { push(std::span((const char8_t*)chunk.data(), chunk.size())); }
+
+    /// There is no more input; Feed::next will now lex up to the EoF.
+    void close() {
+        closed_ = true;
+        lexer_.partial(false);
+        lexer_.restore(lexer_.checkpoint(), buffer_, base_ == 0);
+    }
+    ///@}
+
+    /// @name Pull
+    ///@{
+    /// The next complete token - or `std::nullopt` if we need more input first.
+    /// After Feed::close, this yields the remaining tokens up to and including the EoF token and `std::nullopt`
+    /// afterwards.
+    std::optional<Tok> next() {
+        if (done_) return {};
+        if (closed_) {
+            auto tok = lexer_.lex();
+            done_    = eof_(tok);
+            return tok;
+        }
+        auto checkpoint = lexer_.checkpoint();
+        auto tok        = lexer_.lex();
+        if (!lexer_.starved()) return tok;
+        lexer_.restore(checkpoint, base_ == 0);
+        return {};
+    }
+    ///@}
+
+    /// @name Getters
+    ///@{
+    L& lexer() { return lexer_; }
+    const L& lexer() const { return lexer_; }
+    bool closed() const { return closed_; }
+    bool done() const { return done_; } ///< Has Feed::next delivered the EoF token?
+    size_t base() const { return base_; } ///< Number of bytes dropped in front of the buffer.
+    /// Bytes pushed but not lexed yet - including the ones of a pending incomplete token.
+    size_t pending() const { return buffer_.size() - lexer_.checkpoint().offset; }
+    ///@}
+
+private:
+    std::function<bool(const Tok&)> eof_;
+    std::vector<char8_t> buffer_; // must be initialized before lexer_
+    L lexer_;
+    size_t base_ = 0;
+    bool closed_ = false;
+    bool done_   = false;
+};
+
+} // namespace fe
@@ -0,0 +1,489 @@
+#pragma once
+
+#include <cstdint>
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#    include <arm_neon.h>
+#endif
+
+#include "fe/assert.h"
+
+namespace fe {
+
+/// Finalizer of [MurmurHash3](https://github.com/aappleby/smhasher/wiki/MurmurHash3):
+/// Every bit of @p x affects every bit of the result.
+/// Use it to hash pointers whose low bits are always zero - or that otherwise cluster badly.
+constexpr uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+namespace detail {
+
+/// Control bytes of FlatTable: Group::Size of them are inspected at once - with SSE2 or NEON, if available.
+/// A control byte is either Group::Empty, Group::Deleted, or - if the slot is full - the lower 7 bits of the hash.
+class Group {
+public:
+    static constexpr size_t Size    = 16;
+    static constexpr int8_t Empty   = -128;
+    static constexpr int8_t Deleted = -2;
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    static constexpr int Shift = 0; ///< One bit per slot.
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    static constexpr int Shift = 2; ///< One nibble per slot.
+#else
+    static constexpr int Shift = 0;
+#endif
+
+    /// Set of those slots within a Group that qualify; iterate like this:
+    /// `for (auto m = group.match(h2); m; m = m.next()) use(*m);`
+    class Mask {
+    public:
+        explicit Mask(uint64_t bits)
+            : bits_(bits) {}
+
+        explicit operator bool() const { return bits_ != 0; }
+        size_t operator*() const { return size_t(std::countr_zero(bits_)) >> Shift; } ///< Index of the first slot.
+        Mask next() const { return Mask(bits_ & (bits_ - 1)); }
+
+    private:
+        uint64_t bits_;
+    };
+
+    explicit Group(const int8_t* ctrl)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        : ctrl_(_mm_loadu_si128((const __m128i*)ctrl)) {}
+
+    Mask match(int8_t h2) const {
+        return Mask(unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl_))));
+    }
+    Mask empty() const { return match(Empty); }
+    Mask free() const { return Mask(unsigned(_mm_movemask_epi8(ctrl_))); } ///< Group::Empty or Group::Deleted.
+    Mask full() const { return Mask(~unsigned(_mm_movemask_epi8(ctrl_)) & 0xffff); }
+
+private:
+    __m128i ctrl_;
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        : ctrl_(vld1q_s8(ctrl)) {}
+
+    Mask match(int8_t h2) const { return mask(vceqq_s8(vdupq_n_s8(h2), ctrl_)); }
+    Mask empty() const { return match(Empty); }
+    Mask free() const { return mask(vcltzq_s8(ctrl_)); } ///< Group::Empty or Group::Deleted.
+    Mask full() const { return mask(vcgezq_s8(ctrl_)); }
+
+private:
+    /// There is no `movemask` on NEON: narrow each byte to a nibble and keep one bit of each.
+    static Mask mask(uint8x16_t v) {
+        auto nibbles = vshrn_n_u16(vreinterpretq_u16_u8(v), 4);
+        return Mask(vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & 0x8888888888888888ull);
+    }
+
+    int8x16_t ctrl_;
+#else
+        : ctrl_(ctrl) {}
+
+    Mask match(int8_t h2) const { return mask([h2](int8_t c) { return c == h2; }); }
+    Mask empty() const { return match(Empty); }
+    Mask free() const { return mask([](int8_t c) { return c < 0; }); } ///< Group::Empty or Group::Deleted.
+    Mask full() const { return mask([](int8_t c) { return c >= 0; }); }
+
+private:
+    template<class F> Mask mask(F f) const {
+        uint64_t bits = 0;
+        for (size_t i = 0; i != Size; ++i) bits |= uint64_t(f(ctrl_[i])) << i;
+        return Mask(bits);
+    }
+
+    const int8_t* ctrl_;
+#endif
+};
+
+/// The open-addressing hash table behind FlatMap and FlatSet - a slimmed-down
+/// [Swiss table](https://abseil.io/about/design/swisstables):
+/// The slots are split into Group%s of Group::Size each; probing visits whole Group%s via quadratic probing.
+/// A control byte per slot holds 7 bits of the hash, so we only compare keys whose control bytes already match.
+/// @p T is what a slot holds, @p KeyOf extracts the key `K` from a `T`.
+/// @p Hash should mix well: We use its lower 7 bits for the control byte and the upper ones for the Group index.
+/// @note Allocators only propagate if `propagate_on_container_swap` - as is the case for `std::allocator` but not
+/// Arena::Allocator. Thus, only swap/assign FlatTable%s that use the same Arena.
+template<class K, class T, class KeyOf, class Hash, class Eq, class A> class FlatTable {
+private:
+    using Traits     = std::allocator_traits<A>;
+    using Slot_Alloc = typename Traits::template rebind_alloc<T>;
+    using Ctrl_Alloc = typename Traits::template rebind_alloc<int8_t>;
+    using Slots      = std::allocator_traits<Slot_Alloc>;
+    using Ctrls      = std::allocator_traits<Ctrl_Alloc>;
+
+    static constexpr bool Is_Set = std::is_same_v<K, T>;
+
+public:
+    using key_type        = K;
+    using value_type      = T;
+    using size_type       = size_t;
+    using hasher          = Hash;
+    using key_equal       = Eq;
+    using allocator_type  = A;
+    using reference       = std::conditional_t<Is_Set, const T&, T&>;
+    using const_reference = const T&;
+
+    template<bool Const> class Iter {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = T;
+        using pointer           = std::conditional_t<Const || Is_Set, const T*, T*>;
+        using reference         = std::conditional_t<Const || Is_Set, const T&, T&>;
+
+        Iter() noexcept = default;
+        Iter(const FlatTable* table, size_t i) noexcept
+            : table_(table)
+            , i_(i) {
+            skip();
+        }
+        template<bool C> requires(Const && !C) Iter(const Iter<C>& other) noexcept
+            : table_(other.table_)
+            , i_(other.i_) {}
+
+        reference operator*() const { return table_->slots_[i_]; }
+        pointer operator->() const { return &**this; }
+        Iter& operator++() {
+            ++i_;
+            skip();
+            return *this;
+        }
+        Iter operator++(int) {
+            auto res = *this;
+            ++*this;
+            return res;
+        }
+        template<bool C> bool operator==(const Iter<C>& other) const { return i_ == other.i_; }
+
+    private:
+        void skip() {
+            while (i_ < table_->capacity_ && table_->ctrl_[i_] < 0) ++i_;
+        }
+
+        const FlatTable* table_ = nullptr;
+        size_t i_               = 0;
+
+        template<bool> friend class Iter;
+        friend class FlatTable;
+    };
+
+    using iterator       = Iter<Is_Set>;
+    using const_iterator = Iter<true>;
+
+    /// @name Construction & Destruction
+    ///@{
+    FlatTable() = default;
+    explicit FlatTable(const A& alloc)
+        : alloc_(alloc) {}
+    FlatTable(std::initializer_list<T> list, const A& alloc = A())
+        : alloc_(alloc) {
+        reserve(list.size());
+        for (const auto& t : list) insert(t);
+    }
+    FlatTable(const FlatTable& other)
+        : hash_(other.hash_)
+        , eq_(other.eq_)
+        , alloc_(Traits::select_on_container_copy_construction(other.alloc_)) {
+        reserve(other.size());
+        for (const auto& t : other) insert_unique(t);
+    }
+    FlatTable(FlatTable&& other) noexcept
+        : hash_(std::move(other.hash_))
+        , eq_(std::move(other.eq_))
+        , alloc_(other.alloc_) {
+        steal(other);
+    }
+    FlatTable& operator=(FlatTable other) noexcept { return swap(*this, other), *this; }
+    ~FlatTable() { release(); }
+    ///@}
+
+    /// @name Iterators
+    ///@{
+    iterator begin() { return {this, 0}; }
+    iterator end() { return {this, capacity_}; }
+    const_iterator begin() const { return {this, 0}; }
+    const_iterator end() const { return {this, capacity_}; }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+    ///@}
+
+    /// @name Getters
+    ///@{
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return capacity_; } ///< Number of slots.
+    A get_allocator() const { return alloc_; }
+    ///@}
+
+    /// @name Lookup
+    ///@{
+    iterator find(const K& key) { return {this, find_index(key)}; }
+    const_iterator find(const K& key) const { return {this, find_index(key)}; }
+    bool contains(const K& key) const { return find_index(key) != capacity_; }
+    size_t count(const K& key) const { return contains(key) ? 1 : 0; }
+    ///@}
+
+    /// @name Modifiers
+    ///@{
+    std::pair<iterator, bool> insert(const T& t) { return emplace_key(KeyOf()(t), t); }
+    std::pair<iterator, bool> insert(T&& t) {
+        const auto& key = KeyOf()(t);
+        return emplace_key(key, std::move(t));
+    }
+    template<class... Args> std::pair<iterator, bool> emplace(Args&&... args) {
+        return insert(T(std::forward<Args>(args)...));
+    }
+
+    size_t erase(const K& key) {
+        auto i = find_index(key);
+        if (i == capacity_) return 0;
+        erase_index(i);
+        return 1;
+    }
+    iterator erase(const_iterator pos) {
+        erase_index(pos.i_);
+        return {this, pos.i_ + 1};
+    }
+
+    void clear() {
+        auto sa = slot_alloc();
+        for (size_t i = 0; i != capacity_; ++i)
+            if (ctrl_[i] >= 0) Slots::destroy(sa, slots_ + i);
+        std::fill_n(ctrl_, capacity_, Group::Empty);
+        size_        = 0;
+        growth_left_ = max_load(capacity_);
+    }
+
+    /// Makes room for @p n elements without rehashing.
+    void reserve(size_t n) {
+        auto capacity = std::max(Group::Size, std::bit_ceil(n + n / 7 + 1));
+        if (capacity > capacity_ && n > max_load(capacity_)) rehash(capacity);
+    }
+
+    friend void swap(FlatTable& t1, FlatTable& t2) noexcept {
+        using std::swap;
+        // clang-format off
+        swap(t1.hash_,        t2.hash_       );
+        swap(t1.eq_,          t2.eq_         );
+        if constexpr (Traits::propagate_on_container_swap::value) swap(t1.alloc_, t2.alloc_);
+        swap(t1.ctrl_,        t2.ctrl_       );
+        swap(t1.slots_,       t2.slots_      );
+        swap(t1.capacity_,    t2.capacity_   );
+        swap(t1.size_,        t2.size_       );
+        swap(t1.growth_left_, t2.growth_left_);
+        // clang-format on
+    }
+    ///@}
+
+protected:
+    /// Finds @p key or inserts `T` constructed from @p args - the latter only if @p key is not present.
+    template<class... Args> std::pair<iterator, bool> emplace_key(const K& key, Args&&... args) {
+        auto hash = hash_(key);
+        if (auto i = find_index(key, hash); i != capacity_) return {{this, i}, false};
+        auto sa = slot_alloc();
+        if (growth_left_ == 0) {
+            // FlatTable::prepare_insert may rehash and thus free what @p args refer to - e.g. in
+            // `map.try_emplace(key, map.at(other))`: materialize the element first
+            T t(std::forward<Args>(args)...);
+            auto i = prepare_insert(hash);
+            Slots::construct(sa, slots_ + i, std::move(t));
+            return {{this, i}, true};
+        }
+        auto i = prepare_insert(hash);
+        Slots::construct(sa, slots_ + i, std::forward<Args>(args)...);
+        return {{this, i}, true};
+    }
+
+private:
+    static constexpr size_t max_load(size_t capacity) { return capacity - capacity / 8; } ///< 7/8
+    static int8_t h2(size_t hash) { return int8_t(hash & 0x7f); }
+    size_t num_groups() const { return capacity_ / Group::Size; }
+    Slot_Alloc slot_alloc() const { return Slot_Alloc(alloc_); }
+    Ctrl_Alloc ctrl_alloc() const { return Ctrl_Alloc(alloc_); }
+
+    /// @returns FlatTable::capacity_ if not found.
+    size_t find_index(const K& key) const { return capacity_ == 0 ? 0 : find_index(key, hash_(key)); }
+
+    size_t find_index(const K& key, size_t hash) const {
+        if (capacity_ == 0) return 0;
+        for (size_t g = (hash >> 7) & (num_groups() - 1), step = 0;; g = (g + ++step) & (num_groups() - 1)) {
+            auto base  = g * Group::Size;
+            auto group = Group(ctrl_ + base);
+            for (auto m = group.match(h2(hash)); m; m = m.next())
+                if (eq_(KeyOf()(slots_[base + *m]), key)) return base + *m;
+            if (group.empty()) return capacity_;
+        }
+    }
+
+    /// First free slot along the probe sequence of @p hash; rehashes if necessary. Marks the slot as full.
+    size_t prepare_insert(size_t hash) {
+        auto i = capacity_ == 0 ? 0 : find_free(hash);
+        if (growth_left_ == 0 && (capacity_ == 0 || ctrl_[i] == Group::Empty)) {
+            // grow - or just get rid of the Group::Deleted slots, if there are lots of them
+            rehash(std::max(Group::Size, std::bit_ceil(2 * size_ + 1)));
+            i = find_free(hash);
+        }
+        if (ctrl_[i] == Group::Empty) --growth_left_;
+        ctrl_[i] = h2(hash);
+        ++size_;
+        return i;
+    }
+
+    size_t find_free(size_t hash) const {
+        for (size_t g = (hash >> 7) & (num_groups() - 1), step = 0;; g = (g + ++step) & (num_groups() - 1))
+            if (auto m = Group(ctrl_ + g * Group::Size).free()) return g * Group::Size + *m;
+    }
+
+    void erase_index(size_t i) {
+        assert(i < capacity_ && ctrl_[i] >= 0);
+        auto sa = slot_alloc();
+        Slots::destroy(sa, slots_ + i);
+        --size_;
+        // Once a Group has an empty slot, no probe ever went past it: we can mark i empty as well.
+        auto group = Group(ctrl_ + i / Group::Size * Group::Size);
+        if (group.empty()) {
+            ctrl_[i] = Group::Empty;
+            ++growth_left_;
+        } else {
+            ctrl_[i] = Group::Deleted;
+        }
+    }
+
+    /// Insert @p t which must not be present yet.
+    template<class U> void insert_unique(U&& t) {
+        auto i  = prepare_insert(hash_(KeyOf()(t)));
+        auto sa = slot_alloc();
+        Slots::construct(sa, slots_ + i, std::forward<U>(t));
+    }
+
+    void rehash(size_t capacity) {
+        assert(capacity % Group::Size == 0 && std::has_single_bit(capacity));
+        auto old_ctrl     = ctrl_;
+        auto old_slots    = slots_;
+        auto old_capacity = capacity_;
+
+        auto ca      = ctrl_alloc();
+        auto sa      = slot_alloc();
+        ctrl_        = Ctrls::allocate(ca, capacity);
+        slots_       = Slots::allocate(sa, capacity);
+        capacity_    = capacity;
+        size_        = 0;
+        growth_left_ = max_load(capacity);
+        std::fill_n(ctrl_, capacity, Group::Empty);
+
+        for (size_t i = 0; i != old_capacity; ++i) {
+            if (old_ctrl[i] < 0) continue;
+            insert_unique(std::move(old_slots[i]));
+            Slots::destroy(sa, old_slots + i);
+        }
+        if (old_capacity != 0) {
+            Ctrls::deallocate(ca, old_ctrl, old_capacity);
+            Slots::deallocate(sa, old_slots, old_capacity);
+        }
+    }
+
+    void release() {
+        if (capacity_ == 0) return;
+        clear();
+        auto ca = ctrl_alloc();
+        auto sa = slot_alloc();
+        Ctrls::deallocate(ca, ctrl_, capacity_);
+        Slots::deallocate(sa, slots_, capacity_);
+        ctrl_     = nullptr;
+        slots_    = nullptr;
+        capacity_ = growth_left_ = 0;
+    }
+
+    void steal(FlatTable& other) {
+        // clang-format off
+        ctrl_        = std::exchange(other.ctrl_,        nullptr);
+        slots_       = std::exchange(other.slots_,       nullptr);
+        capacity_    = std::exchange(other.capacity_,    0);
+        size_        = std::exchange(other.size_,        0);
+        growth_left_ = std::exchange(other.growth_left_, 0);
+        // clang-format on
+    }
+
+    [[no_unique_address]] Hash hash_;
+    [[no_unique_address]] Eq eq_;
+    [[no_unique_address]] A alloc_;
+    int8_t* ctrl_       = nullptr;
+    T* slots_           = nullptr;
+    size_t capacity_    = 0;
+    size_t size_        = 0;
+    size_t growth_left_ = 0; ///< How many more elements we can put into empty slots before we have to grow.
+};
+
+struct Identity {
+    template<class T> const T& operator()(const T& t) const { return t; }
+};
+
+struct First {
+    template<class T> const auto& operator()(const T& t) const { return t.first; }
+};
+
+} // namespace detail
+
+/// A flat, open-addressing hash map - see detail::FlatTable.
+/// Unlike `std::unordered_map`, elements move upon rehashing; so do not hold on to pointers or iterators while
+/// inserting.
+/// The elements are `std::pair<K, V>` - modifying FlatMap::value_type::first is not allowed.
+template<class K,
+         class V,
+         class Hash = std::hash<K>,
+         class Eq   = std::equal_to<K>,
+         class A    = std::allocator<std::pair<K, V>>>
+class FlatMap : public detail::FlatTable<K, std::pair<K, V>, detail::First, Hash, Eq, A> {
+private:
+    using Super = detail::FlatTable<K, std::pair<K, V>, detail::First, Hash, Eq, A>;
+
+public:
+    using mapped_type = V;
+    using Super::Super;
+
+    template<class... Args> std::pair<typename Super::iterator, bool> try_emplace(const K& key, Args&&... args) {
+        return this->emplace_key(key, std::piecewise_construct, std::forward_as_tuple(key),
+                                 std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+
+    template<class W> std::pair<typename Super::iterator, bool> insert_or_assign(const K& key, W&& w) {
+        auto res = try_emplace(key, std::forward<W>(w));
+        if (!res.second) res.first->second = std::forward<W>(w);
+        return res;
+    }
+
+    V& operator[](const K& key) { return try_emplace(key).first->second; }
+};
+
+/// A flat, open-addressing hash set - see detail::FlatTable.
+/// Unlike `std::unordered_set`, elements move upon rehashing; so do not hold on to pointers or iterators while
+/// inserting.
+template<class K, class Hash = std::hash<K>, class Eq = std::equal_to<K>, class A = std::allocator<K>>
+class FlatSet : public detail::FlatTable<K, K, detail::Identity, Hash, Eq, A> {
+private:
+    using Super = detail::FlatTable<K, K, detail::Identity, Hash, Eq, A>;
+
+public:
+    using Super::Super;
+};
+
+} // namespace fe
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <algorithm>
 #include <format>
+#include <iterator>
+#include <string>
+#include <string_view>
 
 #include "fe/loc.h"
 #include "fe/utf8.h"
@@ -27,6 +31,28 @@ template<class Char> struct basic_ostream_formatter : std::formatter<std::basic_
 
 using ostream_formatter = basic_ostream_formatter<char>;
 
+/// Base for `std::formatter`s that write directly into the output - without any `std::stringstream` in between.
+/// @p S is the derived formatter and has to provide `template<class O> static O write(O out, const T& value)`.
+/// Width, fill, and alignment work just as for strings; only in this case, we render into a buffer first.
+template<class S, class T> struct direct_formatter : std::formatter<std::string_view> {
+    constexpr auto parse(std::format_parse_context& ctx) {
+        plain_ = ctx.begin() == ctx.end() || *ctx.begin() == '}';
+        return std::formatter<std::string_view>::parse(ctx);
+    }
+
+    template<class O> O format(const T& value, std::basic_format_context<O, char>& ctx) const {
+        if (plain_) return S::write(ctx.out(), value);
+        std::string buf;
+        S::write(std::back_inserter(buf), value);
+        return std::formatter<std::string_view>::format(buf, ctx);
+    }
+
+    template<class O> static O copy(std::string_view s, O out) { return std::copy(s.begin(), s.end(), out); }
+
+private:
+    bool plain_ = true;
+};
+
 // clang-format off
 /// @name out/outln/err/errln
 ///@{
@@ -90,9 +116,55 @@ private:
 } // namespace fe
 
 #ifndef DOXYGEN
-template<> struct std::formatter<fe::Pos> : fe::ostream_formatter {};
-template<> struct std::formatter<fe::Loc> : fe::ostream_formatter {};
-template<> struct std::formatter<fe::Sym> : fe::ostream_formatter {};
-template<> struct std::formatter<fe::Tab> : fe::ostream_formatter {};
-template<> struct std::formatter<fe::utf8::Char32> : fe::ostream_formatter {};
+template<> struct std::formatter<fe::Pos> : fe::direct_formatter<std::formatter<fe::Pos>, fe::Pos> {
+    template<class O> static O write(O out, fe::Pos pos) {
+        if (pos.row) {
+            if (pos.col) return std::format_to(out, "{}:{}", pos.row, pos.col);
+            return std::format_to(out, "{}", pos.row);
+        }
+        return copy("<unknown position>", out);
+    }
+};
+
+template<> struct std::formatter<fe::Loc> : fe::direct_formatter<std::formatter<fe::Loc>, fe::Loc> {
+    using Pos = std::formatter<fe::Pos>;
+
+    template<class O> static O write(O out, fe::Loc loc) {
+        if (!loc) return copy("<unknown location>", out);
+        if (!loc.path)
+            out = copy("<unknown file>", out);
+        else if constexpr (std::is_same_v<std::filesystem::path::value_type, char>)
+            out = copy(loc.path->native(), out); // no copy of the path
+        else
+            out = copy(loc.path->string(), out);
+        *out++ = ':';
+        out    = Pos::write(out, loc.begin);
+        if (loc.begin == loc.finis) return out;
+        if (loc.begin.row != loc.finis.row) return Pos::write(copy("-", out), loc.finis);
+        return std::format_to(out, "-{}", loc.finis.col);
+    }
+};
+
+template<> struct std::formatter<fe::Sym> : std::formatter<std::string_view> {
+    template<class O> O format(fe::Sym sym, std::basic_format_context<O, char>& ctx) const {
+        return std::formatter<std::string_view>::format(sym.view(), ctx);
+    }
+};
+
+template<> struct std::formatter<fe::Tab> : fe::direct_formatter<std::formatter<fe::Tab>, fe::Tab> {
+    template<class O> static O write(O out, fe::Tab tab) {
+        for (size_t i = 0; i != tab.indent(); ++i) out = copy(tab.tab(), out);
+        return out;
+    }
+};
+
+template<>
+struct std::formatter<fe::utf8::Char32> : fe::direct_formatter<std::formatter<fe::utf8::Char32>, fe::utf8::Char32> {
+    template<class O> static O write(O out, fe::utf8::Char32 c) {
+        char8_t buf[fe::utf8::Max];
+        auto end = fe::utf8::encode(buf, c.c);
+        assert(end && "invalid code point");
+        return end ? std::copy(buf, end, out) : out;
+    }
+};
 #endif
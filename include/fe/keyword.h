@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <string_view>
+
+#include "fe/sym.h"
+
+namespace fe {
+
+/// A compile-time [perfect hash](https://en.wikipedia.org/wiki/Perfect_hash_function) table that maps the spellings
+/// of @p N keywords to their @p Tag.
+/// This allows your Lexer to classify an identifier *before* interning it via SymPool::sym - or not interning it at all.
+/// Build it via fe::mk_keywords from your token X-macros like this:
+/// ```
+/// static constexpr auto Keywords = fe::mk_keywords<Tok::Tag>({
+/// #define CODE(t, str) {str, Tok::Tag::t},
+///     LET_KEY(CODE)
+/// #undef CODE
+/// });
+/// // ...
+/// if (auto keyword = Keywords.find(str())) return {loc_, keyword->tag};
+/// return {loc_, driver_.sym(str())};
+/// ```
+/// The table uses [hash and displace](https://cmph.sourceforge.net/papers/esa09.pdf):
+/// Each keyword's hash selects a bucket; each bucket has a displacement which is chosen at compile time such that
+/// all keywords end up in different slots.
+/// A lookup hashes the identifier once and compares it with at most one keyword.
+template<class Tag, size_t N> class Keywords {
+public:
+    struct Keyword {
+        std::string_view str;
+        Tag tag;
+    };
+
+    static constexpr size_t Num_Buckets = std::max(N / 2, size_t(1));
+    static constexpr size_t Num_Slots   = std::bit_ceil(std::max(2 * N, size_t(1)));
+
+    /// @name Construction
+    ///@{
+    /// @p keywords must have distinct spellings.
+    consteval Keywords(const Keyword (&keywords)[N]) {
+        for (size_t i = 0; i != N; ++i) keywords_[i] = keywords[i];
+
+        // place large buckets first - they are most difficult to place
+        std::array<size_t, N> hashes{};
+        std::array<size_t, Num_Buckets> sizes{}, order{};
+        for (size_t i = 0; i != N; ++i) ++sizes[(hashes[i] = hash(keywords_[i].str)) % Num_Buckets];
+        for (size_t b = 0; b != Num_Buckets; ++b) order[b] = b;
+        std::sort(order.begin(), order.end(), [&](size_t b1, size_t b2) { return sizes[b1] > sizes[b2]; });
+
+        slots_.fill(Empty);
+        for (auto b : order) {
+            for (uint32_t d = 0;; ++d) {
+                auto slots = slots_;
+                bool ok    = true;
+                for (size_t i = 0; ok && i != N; ++i) {
+                    if (hashes[i] % Num_Buckets != b) continue;
+                    auto& slot = slots[slot_of(hashes[i], d)];
+                    if (slot != Empty) ok = false; // collision: try next displacement
+                    slot = uint16_t(i);
+                }
+                if (ok) {
+                    displacements_[b] = d;
+                    slots_            = slots;
+                    break;
+                }
+                if (d == 1 << 20) throw "cannot build perfect hash - are there duplicate keywords?";
+            }
+        }
+    }
+    ///@}
+
+    /// @name Lookup
+    ///@{
+    /// @returns the Keyword spelled @p s or `nullptr`, if @p s is no keyword.
+    constexpr const Keyword* find(std::string_view s) const {
+        auto h = hash(s);
+        auto i = slots_[slot_of(h, displacements_[h % Num_Buckets])];
+        return i != Empty && keywords_[i].str == s ? &keywords_[i] : nullptr;
+    }
+    /// Position of @p keyword within the list you passed to fe::mk_keywords.
+    constexpr size_t index(const Keyword* keyword) const { return keyword - keywords_.data(); }
+    ///@}
+
+    /// @name Iterators
+    ///@{
+    constexpr auto begin() const { return keywords_.begin(); }
+    constexpr auto end() const { return keywords_.end(); }
+    static constexpr size_t size() { return N; }
+    ///@}
+
+    /// Interns all keywords in @p syms once - say in your Lexer's constructor.
+    /// @returns the Sym%bols in the order of Keywords::index.
+    std::array<Sym, N> intern(SymPool& syms) const {
+        std::array<Sym, N> res;
+        for (size_t i = 0; i != N; ++i) res[i] = syms.sym(keywords_[i].str);
+        return res;
+    }
+
+private:
+    static constexpr uint16_t Empty = uint16_t(-1);
+    static_assert(N < Empty, "too many keywords");
+
+    /// 64-bit [FNV-1a](https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function).
+    static constexpr size_t hash(std::string_view s) {
+        uint64_t h = UINT64_C(0xcbf29ce484222325);
+        for (auto c : s) h = (h ^ uint8_t(c)) * UINT64_C(0x100000001b3);
+        return size_t(h ^ (h >> 32));
+    }
+
+    static constexpr size_t slot_of(size_t hash, uint32_t displacement) {
+        uint64_t h = (uint64_t(hash) + displacement) * UINT64_C(0x9e3779b97f4a7c15);
+        return size_t(h >> 32) & (Num_Slots - 1);
+    }
+
+    std::array<Keyword, N> keywords_{};
+    std::array<uint32_t, Num_Buckets> displacements_{};
+    std::array<uint16_t, Num_Slots> slots_{};
+};
+
+/// Builds a Keywords table; the number of keywords is deduced from @p keywords.
+template<class Tag, size_t N>
+consteval Keywords<Tag, N> mk_keywords(const typename Keywords<Tag, N>::Keyword (&keywords)[N]) {
+    return Keywords<Tag, N>(keywords);
+}
+
+} // namespace fe
@@ -2,9 +2,11 @@
 
 #include <filesystem>
 #include <istream>
+#include <span>
 
 #include "fe/loc.h"
 #include "fe/ring.h"
+#include "fe/stats.h"
 #include "fe/utf8.h"
 
 namespace fe {
@@ -17,36 +19,169 @@ private:
     const S& self() const { return *static_cast<const S*>(this); }
 
 public:
+    /// @name Construction
+    ///@{
+    /// Lexes from @p istream - use this for pipes and other sources you cannot hold in memory all at once.
     Lexer(std::istream& istream, const std::filesystem::path* path = nullptr)
-        : istream_(istream)
+        : istream_(&istream)
         , loc_(path, {0, 0})
         , peek_(1, 1) {
-        for (size_t i = 0; i != K; ++i) ahead_[i] = utf8::decode(istream_);
-        accept(utf8::BOM); // eat UTF-8 BOM, if present
+        init();
+    }
+    /// Lexes from a contiguous @p buffer (e.g. a file loaded via fe::MMap) - Lexer::next is a mere pointer bump.
+    /// @warning @p buffer must outlive this Lexer.
+    Lexer(std::span<const char8_t> buffer, const std::filesystem::path* path = nullptr)
+        : ptr_(buffer.data())
+        , end_(buffer.data() + buffer.size())
+        , loc_(path, {0, 0})
+        , peek_(1, 1)
+        , begin_(buffer.data()) {
+        init();
     }
+#ifdef FE_STATS
+    ~Lexer() {
+        if (istream_ == nullptr) stats_.bytes = uint64_t(ahead_ptr_[0] - begin_);
+        Stats::record(stats_);
+    }
+#endif
+    ///@}
+
+    /// Set `static constexpr bool Track_Pos = false;` as public member in your child to skip the per-char row/column
+    /// bookkeeping in Lexer::next - e.g. if you use SLoc%s via Lexer::offset and a SourceManager instead.
+    /// Lexer::loc_ and Lexer::peek_ will then stay put.
+    static constexpr bool Track_Pos = true;
+    static constexpr size_t Max_Ahead = K; ///< Number of `char32_t`s Lexer::ahead can look into the future.
+
+    /// @name Checkpoints
+    ///@{
+    /// A Checkpoint captures everything needed to resume lexing at a token boundary - see fe::Relexer.
+    /// Only available if you lex from a buffer.
+    template<class M> struct Checkpoint {
+        uint32_t offset = 0; ///< Byte offset of Lexer::ahead() within the buffer.
+        Pos peek;            ///< Lexer::peek_.
+        M mode;              ///< User state as obtained via Lexer::mode.
+
+        bool operator==(const Checkpoint&) const = default;
+    };
+
+    /// The user state of your Lexer beyond its position - e.g. the nesting depth of comments or whether you are
+    /// within a string interpolation.
+    /// "Override" `Mode`, `Mode mode() const`, and `void mode(Mode)` in your child, if you need this.
+    /// `Mode` must be comparable via `==`.
+    struct Mode {
+        bool operator==(const Mode&) const = default;
+    };
+    Mode mode() const { return {}; }
+    void mode(Mode) {}
+
+    /// Invoke *before* Lexer::start, i.e. at a token boundary.
+    auto checkpoint() const { return Checkpoint<decltype(self().mode())>{offset(), peek_, self().mode()}; }
+
+    /// Resumes at @p checkpoint which may stem from a different Lexer over a different (e.g. edited) buffer.
+    /// The lookahead is decoded anew from the current buffer.
+    /// As the constructor does, this skips a UTF-8 BOM at offset 0 - unless @p bom is `false` because offset 0 is not
+    /// the beginning of the input, e.g. after fe::Feed dropped consumed bytes.
+    template<class M> void restore(const Checkpoint<M>& checkpoint, bool bom = true) {
+        assert(istream_ == nullptr && checkpoint.offset <= size_t(end_ - begin_));
+        ptr_     = begin_ + checkpoint.offset;
+        ascii_   = nullptr;
+        starved_ = false;
+        ahead_.reset();
+        ahead_ptr_.reset();
+        for (size_t i = 0; i != K; ++i) ahead_ptr_[i] = ptr_, ahead_[i] = decode();
+        loc_  = {loc_.path, checkpoint.peek};
+        peek_ = checkpoint.peek;
+        self().mode(checkpoint.mode);
+        if (bom && checkpoint.offset == 0) accept(utf8::BOM);
+    }
+
+    /// Same as above but lexes from @p buffer from now on.
+    template<class M> void restore(const Checkpoint<M>& checkpoint, std::span<const char8_t> buffer, bool bom = true) {
+        assert(istream_ == nullptr);
+        begin_ = buffer.data();
+        end_   = buffer.data() + buffer.size();
+        restore(checkpoint, bom);
+    }
+    ///@}
+
+    /// @name Partial Input
+    ///@{
+    /// If the buffer is only a prefix of the input - see fe::Feed -, its end is not the end of the input:
+    /// Instead of decoding an incomplete UTF-8 sequence or hitting the end of the buffer, Lexer::ahead yields
+    /// utf8::EoF and Lexer::starved becomes `true` - which means the current token may be incomplete.
+    /// Takes effect with the next Lexer::restore.
+    void partial(bool partial) { partial_ = partial; }
+    bool partial() const { return partial_; }
+    /// Did the Lexer run into the end of a Lexer::partial buffer since the last Lexer::restore?
+    /// Better check this before reporting errors like an unterminated comment.
+    bool starved() const { return starved_; }
+    ///@}
 
 protected:
     char32_t ahead(size_t i = 0) const { return ahead_[i]; }
 
+    /// Byte offset of Lexer::ahead(@p i) within the buffer - only available if you lex from a buffer.
+    uint32_t offset(size_t i = 0) const {
+        assert(istream_ == nullptr);
+        return uint32_t(ahead_ptr_[i] - begin_);
+    }
+
     /// Invoke before assembling the next token.
     void start() {
+#ifdef FE_STATS
+        if (ahead() != utf8::EoF)
+            ++stats_.tokens;
+        else if (stats_.time.count() == 0)
+            stats_.time = std::chrono::steady_clock::now() - start_;
+#endif
         loc_.begin = peek_;
         str_.clear();
+        spell_ = {};
+        copy_  = istream_ != nullptr;
+    }
+
+    /// The spelling of the token we are currently constructing.
+    /// If the Lexer operates on a buffer, this is a view into the buffer and Lexer::str_ is only built
+    /// if the spelling deviates from the input - due to Append::Lower/Append::Upper, Lexer::append, or gaps.
+    std::string_view str() const { return copy_ ? std::string_view(str_) : spell_; }
+
+    /// Appends @p c to the spelling of the current token - e.g. the char an escape sequence stands for.
+    void append(char32_t c) {
+        if (!copy_) {
+            str_.assign(spell_);
+            copy_ = true;
+        }
+        if (c <= 0x7f) {
+            str_ += char(c);
+        } else {
+            char8_t buf[utf8::Max];
+            if (auto end = utf8::encode(buf, c)) str_.append((const char*)buf, end - buf); // skips EoF
+        }
     }
 
-    /// Get next `char32_t` in Lexer::istream_ and increase Lexer::loc_.
+    /// Get next `char32_t` in the input and increase Lexer::loc_.
     /// @returns Null on an invalid UTF-8 sequence.
     char32_t next() {
-        loc_.finis = peek_;
-        auto res   = ahead();
-        auto curr  = ahead_.put(utf8::decode(istream_));
-
-        if (curr == '\n') {
-            ++peek_.row, peek_.col = 0;
-        } else if (curr == utf8::EoF) {
-            /* do nothing */
-        } else {
-            ++peek_.col;
+        auto res = ahead();
+        ahead_ptr_.put(ptr_);
+        ahead_.put(decode());
+#ifdef FE_STATS
+        if (res != utf8::EoF) {
+            ++stats_.chars;
+            if (istream_) stats_.bytes += res <= 0x7f ? 1 : res <= 0x7ff ? 2 : res <= 0xffff ? 3 : 4;
+        }
+#endif
+
+        if constexpr (S::Track_Pos) {
+            loc_.finis = peek_;
+            auto curr  = ahead();
+            if (curr == '\n') {
+                ++peek_.row, peek_.col = 0;
+            } else if (curr == utf8::EoF) {
+                /* do nothing */
+            } else {
+                ++peek_.col;
+            }
         }
 
         return res;
@@ -54,26 +189,30 @@ protected:
 
     /// @name Accept
     ///@{
-    /// Accept next character in Lexer::istream_, depending on some condition.
+    /// Accept next character in the input, depending on some condition.
 
     /// What should happend to the accepted char?
     /// Normalize identifiers via Append::Lower or Append::Upper for case-insensitive languages like FORTRAN or SQL.
+    /// Both only map ASCII and give up the zero-copy spelling as soon as they change a char;
+    /// better accept identifiers via Append::On and intern them via SymPool::sym_fold.
     enum class Append {
-        Off,   ///< Do not append accepted char to Lexer::str_.
-        On,    ///< Append accepted char as is to Lexer::str_.
-        Lower, ///< Append accepted char via fe::utf8::tolower` to Lexer::str_.
-        Upper, ///< Append accepted char via fe::utf8::toupper` to Lexer::str_.
+        Off,   ///< Do not append accepted char to Lexer::str.
+        On,    ///< Append accepted char as is to Lexer::str.
+        Lower, ///< Append accepted char via `fe::utf8::tolower` to Lexer::str.
+        Upper, ///< Append accepted char via `fe::utf8::toupper` to Lexer::str.
     };
 
     /// @returns `true` if @p pred holds.
-    /// In this case invoke Lexer::next() and append to Lexer::str_, if @p append.
+    /// In this case invoke Lexer::next() and append to Lexer::str, if @p append.
     template<Append append = Append::On, class Pred> bool accept(Pred pred) {
         if (pred(ahead())) {
-            auto c = self().next();
+            auto begin = ahead_ptr_[0];
+            auto c     = self().next();
             if constexpr (append != Append::Off) {
-                if constexpr (append == Append::Lower) c = fe::utf8::tolower(c);
-                if constexpr (append == Append::Upper) c = fe::utf8::toupper(c);
-                str_ += c;
+                auto d = c;
+                if constexpr (append == Append::Lower) d = fe::utf8::tolower(c);
+                if constexpr (append == Append::Upper) d = fe::utf8::toupper(c);
+                if (c != d || !extend(begin, ahead_ptr_[0])) this->append(d);
             }
             return true;
         }
@@ -85,13 +224,77 @@ protected:
     template<Append append = Append::On> bool accept(char     c) { return accept<append>((char32_t)c); }
     template<Append append = Append::On> bool accept(char8_t  c) { return accept<append>((char32_t)c); }
     // clang-format on
+
+    /// Consumes the longest spelling of @p puncts - see fe::Punctuators - in the input.
+    /// Nothing is appended to Lexer::str.
+    /// @returns the Punctuator or `nullptr`, if none matches; in this case nothing is consumed.
+    template<class P> auto accept_longest(const P& puncts) {
+        decltype(puncts.accepting(P::Root)) res = nullptr;
+        for (auto state = P::Root;;) {
+            auto next = puncts.step(state, ahead());
+            if (next == P::None) return res;
+
+            // proceed to a non-accepting state only if we can see an accepting one behind it
+            size_t n = 1;
+            while (!puncts.accepting(next) && n != K)
+                if ((next = puncts.step(next, ahead(n++))) == P::None) return res;
+            if (!puncts.accepting(next)) return res;
+
+            for (size_t i = 0; i != n; ++i) self().next();
+            state = next;
+            res   = puncts.accepting(state);
+        }
+    }
     ///@}
 
-    std::istream& istream_;
+    std::istream* istream_ = nullptr; ///< Only set, if we lex from a `std::istream`; otherwise we use [ptr_, end_).
+    const char8_t* ptr_    = nullptr;
+    const char8_t* end_    = nullptr;
     Ring<char32_t, K> ahead_;
-    Loc loc_;  ///< Loc%ation of the token we are currently constructing within Lexer::str_,
+    Loc loc_;  ///< Loc%ation of the token we are currently constructing within Lexer::str,
     Pos peek_; ///< Pos%ition of ahead_::first;
-    std::string str_;
+    std::string str_; ///< Use Lexer::str to retrieve the spelling - this one may be empty.
+
+private:
+    void init() {
+        for (size_t i = 0; i != K; ++i) ahead_ptr_[i] = ptr_, ahead_[i] = decode();
+        accept(utf8::BOM); // eat UTF-8 BOM, if present
+    }
+
+    /// Tries to extend the zero-copy spelling with [@p begin, @p end).
+    bool extend(const char8_t* begin, const char8_t* end) {
+        if (copy_) return false;
+        auto size = size_t(end - begin);
+        if (spell_.empty()) return spell_ = {(const char*)begin, size}, true;
+        if ((const char8_t*)spell_.data() + spell_.size() != begin) return false;
+        return spell_ = {spell_.data(), spell_.size() + size}, true;
+    }
+
+    char32_t decode() {
+        if (istream_) return utf8::decode(*istream_);
+        if (ptr_ < ascii_) return *ptr_++; // within a known ASCII run: no multi-byte handling necessary
+        if (ptr_ != end_ && *ptr_ < 0x80) {
+            ascii_ = utf8::skip_ascii(ptr_, end_);
+            return *ptr_++;
+        }
+        if (partial_ && (ptr_ == end_ || size_t(end_ - ptr_) < utf8::num_bytes(*ptr_))) {
+            starved_ = true; // more bytes may follow
+            return utf8::EoF;
+        }
+        return utf8::decode(ptr_, end_);
+    }
+
+    const char8_t* begin_ = nullptr; ///< Begin of the buffer.
+    const char8_t* ascii_ = nullptr; ///< [ptr_, ascii_) is known to be ASCII.
+    Ring<const char8_t*, K> ahead_ptr_; ///< Where Lexer::ahead_ begins within the buffer.
+    std::string_view spell_;            ///< Zero-copy spelling within the buffer.
+    bool copy_    = true;               ///< Do we have to build the spelling in Lexer::str_?
+    bool partial_ = false;              ///< See Lexer::partial.
+    bool starved_ = false;              ///< See Lexer::starved.
+#ifdef FE_STATS
+    Stats::Lexer stats_;
+    std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+#endif
 };
 
 } // namespace fe
@@ -1,29 +1,21 @@
+#include <iterator>
+
 #include "fe/loc.h"
 
 #include "fe/format.h"
 
 namespace fe {
 
+// Both simply reuse the std::formatter%s of fe/format.h, so streams and std::format always agree.
+
 std::ostream& operator<<(std::ostream& os, const Pos pos) {
-    if (pos.row) {
-        if (pos.col) return os << pos.row << ':' << pos.col;
-        return os << pos.row;
-    }
-    return os << "<unknown position>";
+    std::formatter<Pos>::write(std::ostreambuf_iterator<char>(os), pos);
+    return os;
 }
 
 std::ostream& operator<<(std::ostream& os, const Loc loc) {
-    if (loc) {
-        os << (loc.path ? loc.path->string() : "<unknown file>") << ':' << loc.begin;
-        if (loc.begin != loc.finis) {
-            if (loc.begin.row != loc.finis.row)
-                os << '-' << loc.finis;
-            else
-                os << '-' << loc.finis.col;
-        }
-        return os;
-    }
-    return os << "<unknown location>";
+    std::formatter<Loc>::write(std::ostreambuf_iterator<char>(os), loc);
+    return os;
 }
 
 } // namespace fe
@@ -22,7 +22,9 @@ struct Pos {
     uint16_t row = 0;
     uint16_t col = 0;
 
-    /// Write your own implementation or include fe/loc.cpp.h somewhere for a default one.
+    /// Include fe/loc.cpp.h in exactly one translation unit for the implementation.
+    /// It forwards to the `std::formatter` of fe/format.h - so do not roll your own: `std::format`, Diag, and
+    /// BufferedSink would print Loc%ations differently then.
     friend std::ostream& operator<<(std::ostream& os, const Pos pos);
 };
 
@@ -57,7 +59,9 @@ struct Loc {
     ///< It's called `finis` because it refers to the **last** character within this Loc%ation.
     /// In the STL the word `end` refers to the position of something that is one element **past** the end.
 
-    /// Write your own implementation or include fe/loc.cpp.h somewhere for a default one.
+    /// Include fe/loc.cpp.h in exactly one translation unit for the implementation.
+    /// It forwards to the `std::formatter` of fe/format.h - so do not roll your own: `std::format`, Diag, and
+    /// BufferedSink would print Loc%ations differently then.
     friend std::ostream& operator<<(std::ostream& os, const Loc loc);
 };
 
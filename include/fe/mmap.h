@@ -0,0 +1,106 @@
+#pragma once
+
+#include <filesystem>
+#include <span>
+
+#ifdef _WIN32
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    ifndef WIN32_LEAN_AND_MEAN
+#        define WIN32_LEAN_AND_MEAN
+#    endif
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace fe {
+
+/// Maps a file read-only into memory.
+/// Feed MMap::span into the buffer-based constructor of Lexer to avoid any `std::istream` overhead.
+/// Use like this:
+/// ```
+/// fe::MMap mmap(path);
+/// if (!mmap) error("cannot read file '{}'", path);
+/// Lexer lexer(driver, mmap.span(), &path);
+/// ```
+class MMap {
+public:
+    /// @name Construction/Destruction
+    ///@{
+    MMap() noexcept = default; ///< Creates an invalid MMap.
+    MMap(const std::filesystem::path& path) noexcept {
+#ifdef _WIN32
+        auto file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return;
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(file, &size)) {
+            if (size.QuadPart == 0) {
+                valid_ = true;
+            } else if (auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr)) {
+                if (auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) {
+                    data_  = static_cast<const char8_t*>(view);
+                    size_  = size_t(size.QuadPart);
+                    valid_ = true;
+                }
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+#else
+        auto fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1) return;
+        struct stat st;
+        if (::fstat(fd, &st) == 0) {
+            if (st.st_size == 0) {
+                valid_ = true;
+            } else if (auto p = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0); p != MAP_FAILED) {
+                ::madvise(p, size_t(st.st_size), MADV_SEQUENTIAL);
+                data_  = static_cast<const char8_t*>(p);
+                size_  = size_t(st.st_size);
+                valid_ = true;
+            }
+        }
+        ::close(fd);
+#endif
+    }
+    MMap(const MMap&) = delete;
+    MMap(MMap&& other) noexcept { swap(*this, other); }
+    ~MMap() {
+        if (data_ == nullptr) return;
+#ifdef _WIN32
+        UnmapViewOfFile(data_);
+#else
+        ::munmap(const_cast<char8_t*>(data_), size_);
+#endif
+    }
+    MMap& operator=(MMap other) noexcept { return swap(*this, other), *this; }
+    ///@}
+
+    /// @name Getters
+    ///@{
+    explicit operator bool() const { return valid_; } ///< Has the file been successfully mapped?
+    const char8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    std::span<const char8_t> span() const { return {data_, size_}; }
+    ///@}
+
+    friend void swap(MMap& m1, MMap& m2) noexcept {
+        using std::swap;
+        swap(m1.data_, m2.data_);
+        swap(m1.size_, m2.size_);
+        swap(m1.valid_, m2.valid_);
+    }
+
+private:
+    const char8_t* data_ = nullptr;
+    size_t size_         = 0;
+    bool valid_          = false;
+};
+
+} // namespace fe
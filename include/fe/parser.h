@@ -1,12 +1,32 @@
 #pragma once
 
 #include <optional>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 #include "fe/loc.h"
 #include "fe/ring.h"
+#include "fe/stats.h"
 
 namespace fe {
 
+/// Remembers where a grammar rule starts; yields the Loc%ation of everything parsed since then.
+/// See Parser::tracker.
+class Tracker {
+public:
+    Tracker(Loc& prev, Pos pos)
+        : prev_(prev)
+        , pos_(pos) {}
+
+    Loc loc() const { return {prev_.path, pos_, prev_.finis}; }
+    operator Loc() const {  return loc(); }
+
+private:
+    const Loc& prev_;
+    Pos pos_;
+};
+
 /// The blueprint for a [recursive descent](https://en.wikipedia.org/wiki/Recursive_descent_parser)/
 /// [ascent parser](https://en.wikipedia.org/wiki/Recursive_ascent_parser) using a @p K lookahead of `Tok`ens.
 template<class Tok, class Tag, size_t K, class S> class Parser {
@@ -18,10 +38,15 @@ protected:
     /// @name Construction
     ///@{
     void init(const std::filesystem::path* path) {
+        buffer_.clear();
+        pos_ = base_ = num_marks_ = 0;
         ahead_.reset();
-        for (size_t i = 0; i != K; ++i) ahead_[i] = self().lexer().lex();
+        for (size_t i = 0; i != K; ++i) ahead_[i] = fetch();
         prev_ = Loc(path, {1, 1});
     }
+#ifdef FE_STATS
+    ~Parser() { Stats::record(stats_); }
+#endif
     ///@}
 
     /// @name Track Loc%ation in Source File
@@ -33,21 +58,9 @@ protected:
     /// auto bar    = parse_bar();
     /// auto foobar = new FooBar(track, foo, bar);
     /// ```
-    class Tracker {
-    public:
-        Tracker(Loc& prev, Pos pos)
-            : prev_(prev)
-            , pos_(pos) {}
-
-        Loc loc() const { return {prev_.path, pos_, prev_.finis}; }
-        operator Loc() const {  return loc(); }
-
-    private:
-        const Loc& prev_;
-        Pos pos_;
-    };
+    using Tracker = fe::Tracker;
 
-    /// Factory method to build a Parser::Tracker.
+    /// Factory method to build a Tracker.
     Tracker tracker() { return {prev_, ahead().loc().begin}; }
     ///@}
 
@@ -55,13 +68,13 @@ protected:
     ///@{
 
     /// Get lookahead.
-    Tok ahead(size_t i = 0) const { return ahead_[i]; }
+    const Tok& ahead(size_t i = 0) const { return ahead_[i]; }
 
-    /// Invoke Lexer to retrieve next Token.
+    /// Invoke Lexer to retrieve next Token - or replay it after a Parser::rewind.
     Tok lex() {
-        auto result = ahead();
+        auto result = std::move(ahead_.front());
         prev_       = result.loc();
-        ahead_.put(self().lexer().lex());
+        ahead_.put(fetch());
         return result;
     }
 
@@ -86,8 +99,122 @@ protected:
     }
     ///@}
 
+    /// @name Speculation
+    ///@{
+    /// Backtracking for grammars that need unbounded lookahead - e.g. declaration vs. expression in C++.
+    /// While a Mark is active, all tokens are recorded in a buffer, so Parser::rewind can replay them without
+    /// lexing anything twice.
+    /// Use like this:
+    /// ```
+    /// auto mark = this->mark();
+    /// if (auto decl = try_parse_decl()) return commit(mark), decl;
+    /// rewind(mark);
+    /// return parse_expr();
+    /// ```
+    /// Each Mark must be released via either Parser::commit or Parser::rewind; they may nest.
+    struct Mark {
+        size_t pos; ///< Number of tokens fetched so far.
+        Ring<Tok, K> ahead;
+        Loc prev;
+    };
+
+    Mark mark() {
+        static_assert(std::is_copy_constructible_v<Tok>, "speculation needs copyable tokens");
+        ++num_marks_;
+        return {pos_, ahead_, prev_};
+    }
+
+    /// Go back to @p mark.
+    void rewind(const Mark& mark) {
+        assert(num_marks_ > 0 && base_ <= mark.pos && mark.pos <= base_ + buffer_.size());
+        --num_marks_;
+        restore(mark);
+    }
+
+    /// Keep everything parsed since @p mark.
+    void commit(const Mark&) {
+        assert(num_marks_ > 0);
+        if (--num_marks_ == 0 && pos_ == base_ + buffer_.size()) drop();
+    }
+
+    /// [Packrat](https://en.wikipedia.org/wiki/Packrat_parser)-style memo table for the results of *one* rule.
+    template<class R> using Memo = std::unordered_map<size_t, std::pair<R, Mark>>;
+
+    /// Invokes @p f - which parses a rule whose results go into @p memo - unless we already did so here.
+    /// In the latter case, we return the memoized result and skip all tokens @p f consumed last time.
+    /// Only memoizes while a Mark is active - otherwise, we will never come back here anyway.
+    template<class R, class F> R memoize(Memo<R>& memo, F f) {
+        if (num_marks_ == 0) return f();
+
+        auto key = pos_;
+        if (auto i = memo.find(key); i != memo.end()) {
+            if (auto& [res, end] = i->second; end.pos <= base_ + buffer_.size()) {
+                restore(end);
+                return res;
+            }
+        }
+
+        auto res = f();
+        memo.insert_or_assign(key, std::pair(res, Mark{pos_, ahead_, prev_}));
+        return res;
+    }
+    ///@}
+
     Ring<Tok, K> ahead_;
     Loc prev_;
+
+private:
+    /// Next token from the buffer, if we are replaying, or from the Lexer otherwise.
+    Tok fetch() {
+        if constexpr (std::is_copy_constructible_v<Tok>) {
+            if (pos_ != base_ + buffer_.size()) {
+#ifdef FE_STATS
+                ++stats_.replays;
+#endif
+                auto tok = buffer_[pos_++ - base_];
+                if (num_marks_ == 0 && pos_ == base_ + buffer_.size()) drop();
+                return tok;
+            }
+
+            auto tok = self().lexer().lex();
+#ifdef FE_STATS
+            ++stats_.fills;
+#endif
+            ++pos_;
+            if (num_marks_ != 0)
+                buffer_.push_back(tok);
+            else
+                base_ = pos_;
+            return tok;
+        } else {
+#ifdef FE_STATS
+            ++stats_.fills;
+#endif
+            return self().lexer().lex(); // no Mark%s - nothing to record
+        }
+    }
+
+    void restore(const Mark& mark) {
+        pos_   = mark.pos;
+        ahead_ = mark.ahead;
+        prev_  = mark.prev;
+    }
+
+    /// No Mark is active and we are done replaying: Forget the buffer but keep its memory.
+    void drop() {
+        base_ += buffer_.size();
+        buffer_.clear();
+    }
+
+    /// Tokens [base_, base_ + size); a plain `std::vector` keeps its capacity across Parser::drop and - unlike an
+    /// Arena::Allocator bound to a member Arena - survives moving the Parser.
+    std::vector<Tok> buffer_;
+    size_t base_      = 0; ///< Position of buffer_'s first token.
+    size_t pos_       = 0; ///< Number of tokens fetched so far - i.e. the position of the token behind ahead_.
+    size_t num_marks_ = 0;
+#ifdef FE_STATS
+    Stats::Parser stats_;
+#endif
 };
 
 } // namespace fe
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <string_view>
+
+namespace fe {
+
+/// A compile-time [trie](https://en.wikipedia.org/wiki/Trie) - i.e. a DFA - over the spellings of @p N fixed tokens
+/// like operators and punctuation, each of which is at most @p L Unicode code points long.
+/// Lexer::accept_longest walks it along Lexer::ahead and consumes the longest spelling in one pass - instead of a
+/// chain of Lexer::accept%s, one per token.
+/// Build it via fe::mk_punctuators from your token X-macros like this:
+/// ```
+/// static constexpr auto Puncts = fe::mk_punctuators<Tok::Tag>({
+/// #define CODE(t, str) {str, Tok::Tag::t},
+///     LET_PUNCT(CODE)
+/// #undef CODE
+/// });
+/// // ...
+/// if (auto punct = accept_longest(Puncts)) return {loc_, punct->tag};
+/// ```
+/// The first char is looked up in a table indexed by ASCII; all further ones in the (usually tiny) sorted list of
+/// transitions of the current state.
+/// @note Lexer::accept_longest never backtracks: It only proceeds to a state that is no spelling itself - e.g. `..` for
+/// `.` and `...` - if it can see the accepting state within Lexer::ahead. Punctuators::lookahead tells you which
+/// Lexer::Max_Ahead you need so that you don't miss any spelling.
+template<class Tag, size_t N, size_t L = 4> class Punctuators {
+public:
+    struct Punctuator {
+        std::string_view str; ///< UTF-8.
+        Tag tag;
+    };
+
+    using State                         = uint16_t;
+    static constexpr State Root         = 0;
+    static constexpr State None         = State(-1);
+    static constexpr size_t Max_States  = 1 + N * L;
+    static constexpr size_t Num_Initial = 128;
+
+    /// @name Construction
+    ///@{
+    /// @p puncts must have distinct, non-empty spellings.
+    consteval Punctuators(const Punctuator (&puncts)[N]) {
+        for (size_t i = 0; i != N; ++i) puncts_[i] = puncts[i];
+        initial_.fill(None);
+        for (auto& state : states_) state = {0, 0, Empty};
+
+        // build trie - edges are unordered for now
+        struct Raw {
+            State from, to;
+            char32_t c;
+        };
+        std::array<Raw, N * L> raw{};
+        size_t num_raw = 0;
+        for (size_t i = 0; i != N; ++i) {
+            auto s = puncts_[i].str;
+            if (s.empty()) throw "empty spelling";
+            State state = Root;
+            size_t len  = 0;
+            for (size_t j = 0; j != s.size();) {
+                auto c = decode(s, j);
+                if (++len > L) throw "spelling too long - increase L";
+                State next = None;
+                for (size_t k = 0; k != num_raw; ++k)
+                    if (raw[k].from == state && raw[k].c == c) next = raw[k].to;
+                if (next == None) {
+                    next           = State(num_states_++);
+                    raw[num_raw++] = {state, next, c};
+                }
+                state = next;
+            }
+            if (states_[state].punct != Empty) throw "duplicate spelling";
+            states_[state].punct = uint16_t(i);
+        }
+
+        // lay out the edges of each state contiguously and sorted by char
+        std::sort(raw.begin(), raw.begin() + num_raw, [](const Raw& r1, const Raw& r2) {
+            return r1.from != r2.from ? r1.from < r2.from : r1.c < r2.c;
+        });
+        for (size_t k = 0; k != num_raw; ++k) {
+            auto& state = states_[raw[k].from];
+            if (state.num == 0) state.first = uint16_t(k);
+            ++state.num;
+            edges_[k] = {raw[k].c, raw[k].to};
+            if (raw[k].from == Root && raw[k].c < Num_Initial) initial_[raw[k].c] = raw[k].to;
+        }
+    }
+    ///@}
+
+    /// @name DFA
+    ///@{
+    /// Transition from @p state via @p c - or Punctuators::None.
+    constexpr State step(State state, char32_t c) const {
+        if (state == Root && c < Num_Initial) return initial_[c];
+        auto& node = states_[state];
+        for (auto e = edges_.begin() + node.first, end = e + node.num; e != end && e->c <= c; ++e)
+            if (e->c == c) return e->to;
+        return None;
+    }
+    /// @returns the Punctuator spelled by the path to @p state or `nullptr`, if there is none.
+    constexpr const Punctuator* accepting(State state) const {
+        auto i = states_[state].punct;
+        return i != Empty ? &puncts_[i] : nullptr;
+    }
+    ///@}
+
+    /// @name Lookup
+    ///@{
+    /// @returns the Punctuator spelled *exactly* @p s or `nullptr`, if there is none.
+    constexpr const Punctuator* find(std::string_view s) const {
+        State state = Root;
+        for (size_t j = 0; j != s.size() && state != None;) state = step(state, decode(s, j));
+        return state != None ? accepting(state) : nullptr;
+    }
+    /// Position of @p punct within the list you passed to fe::mk_punctuators.
+    constexpr size_t index(const Punctuator* punct) const { return punct - puncts_.data(); }
+    ///@}
+
+    /// @name Getters
+    ///@{
+    constexpr auto begin() const { return puncts_.begin(); }
+    constexpr auto end() const { return puncts_.end(); }
+    static constexpr size_t size() { return N; }
+    constexpr size_t num_states() const { return num_states_; }
+
+    /// The Lexer::Max_Ahead required to never miss a spelling:
+    /// The longest run of states along a spelling that are no spelling themselves - plus one.
+    constexpr size_t lookahead() const {
+        size_t res = 1;
+        for (auto& punct : puncts_) {
+            State state = Root;
+            size_t run  = 0;
+            for (size_t j = 0; j != punct.str.size();) {
+                state = step(state, decode(punct.str, j));
+                run   = accepting(state) ? 0 : run + 1;
+                res   = std::max(res, run + 1);
+            }
+        }
+        return res;
+    }
+    ///@}
+
+private:
+    static constexpr uint16_t Empty = uint16_t(-1);
+    static_assert(Max_States < None, "too many punctuators");
+
+    /// Decodes the UTF-8 sequence at @p s[@p j] and advances @p j.
+    static constexpr char32_t decode(std::string_view s, size_t& j) {
+        auto b = uint8_t(s[j++]);
+        if (b < 0x80) return b;
+        size_t n   = b >= 0xf0 ? 3 : b >= 0xe0 ? 2 : 1;
+        char32_t c = b & (0x3f >> n);
+        for (size_t i = 0; i != n && j != s.size(); ++i) c = (c << 6) | (uint8_t(s[j++]) & 0x3f);
+        return c;
+    }
+
+    struct Node {
+        uint16_t first; ///< Index of the first outgoing edge.
+        uint16_t num;   ///< Number of outgoing edges.
+        uint16_t punct; ///< Index of the Punctuator, if this State accepts.
+    };
+    struct Edge {
+        char32_t c;
+        State to;
+    };
+
+    std::array<Punctuator, N> puncts_{};
+    std::array<State, Num_Initial> initial_{}; ///< Root's transitions for ASCII.
+    std::array<Node, Max_States> states_{};
+    std::array<Edge, N * L> edges_{};
+    size_t num_states_ = 1;
+};
+
+/// Builds a Punctuators DFA; the number of punctuators is deduced from @p puncts.
+/// @p L bounds the length of a spelling in code points.
+template<class Tag, size_t L = 4, size_t N>
+consteval Punctuators<Tag, N, L> mk_punctuators(const typename Punctuators<Tag, N, L>::Punctuator (&puncts)[N]) {
+    return Punctuators<Tag, N, L>(puncts);
+}
+
+} // namespace fe
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cstdint>
+
+#include <algorithm>
+#include <functional>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "fe/loc.h"
+#include "fe/utf8.h"
+
+namespace fe {
+
+/// Incrementally re-lexes a buffer after an edit - e.g. for an editor or a language server.
+/// Relexer remembers each token together with the Lexer::Checkpoint right before it.
+/// After an edit, it resumes from the nearest Lexer::Checkpoint in front of the edited range and stops as soon as
+/// it arrives at a Lexer::Checkpoint that lines up with an old one again.
+/// The tokens are kept in a gap buffer that sits at the last edit; the Checkpoint%s behind the gap are stored relative
+/// to a lazily applied offset and row delta.
+/// So the work is proportional to the size of the edit - plus the distance to the previous edit and the rest of the
+/// edited line - rather than the size of the file.
+/// Use like this:
+/// ```
+/// fe::Relexer<Lexer> relexer([](const Tok& tok) { return tok.tag() == Tok::Tag::T_EoF; });
+/// Lexer lexer(driver, buffer);
+/// relexer.lex(lexer);
+/// // user replaces [begin, end) of buffer by size new bytes
+/// Lexer lexer2(driver, new_buffer);
+/// auto change = relexer.relex(lexer2, begin, end, size);
+/// ```
+/// @p L is your Lexer; it must lex from a buffer.
+/// @note Tokens behind the edit are kept as is - if they carry absolute positions, shift them via Change::delta.
+/// Their Relexer::checkpoint, however, is kept up to date.
+template<class L> class Relexer {
+public:
+    using Tok        = std::invoke_result_t<decltype(&L::lex), L&>;
+    using Checkpoint = std::invoke_result_t<decltype(&L::checkpoint), const L&>;
+
+    struct Entry {
+        Checkpoint checkpoint; ///< Lexer state right before Entry::tok.
+        Tok tok;
+    };
+
+    /// Describes what Relexer::relex did: Entries [Change::begin, Change::begin + Change::num_old) have been replaced
+    /// by [Change::begin, Change::begin + Change::num_new).
+    struct Change {
+        size_t begin   = 0;
+        size_t num_old = 0;
+        size_t num_new = 0;
+        int64_t delta  = 0; ///< Byte offsets behind the edit moved by this much.
+    };
+
+    /// @p eof identifies the last token.
+    Relexer(std::function<bool(const Tok&)> eof)
+        : eof_(std::move(eof)) {}
+
+    /// @name Lex
+    ///@{
+    /// Lexes everything from @p lexer's current position.
+    void lex(L& lexer) {
+        front_.clear();
+        back_.clear();
+        delta_ = 0;
+        rows_  = 0;
+        while (true) {
+            front_.push_back({lexer.checkpoint(), lexer.lex()});
+            if (eof_(front_.back().tok)) return;
+        }
+    }
+
+    /// The bytes [@p begin, @p end) of the old buffer have been replaced by @p size new bytes;
+    /// @p lexer must lex from the *new* buffer.
+    /// An edit in front of the very first token - e.g. of a UTF-8 BOM - lexes everything anew from offset 0.
+    Change relex(L& lexer, uint32_t begin, uint32_t end, uint32_t size) {
+        auto first   = find(begin);
+        auto change  = Change{first, 0, 0, int64_t(size) - int64_t(end - begin)};
+        auto new_end = begin + size;
+        seek(first);
+        if (!back_.empty()) {
+            auto checkpoint = absolute(back_.back().checkpoint);
+            if (begin < checkpoint.offset) checkpoint.offset = 0, checkpoint.peek = Pos(1, 1);
+            lexer.restore(checkpoint);
+        }
+
+        // lex into front_ while back_ still holds the old Checkpoint%s behind the gap
+        auto old = back_.rbegin();
+        while (true) {
+            auto checkpoint = lexer.checkpoint();
+            if (checkpoint.offset >= new_end) {
+                // is there an old Checkpoint behind the edit that matches ours?
+                auto offset = int64_t(checkpoint.offset) - change.delta;
+                old = std::lower_bound(old, back_.rend(), offset, [this](const Entry& e, int64_t offset) {
+                    return absolute(e.checkpoint).offset < offset;
+                });
+                if (old != back_.rend()) {
+                    auto cp = absolute(old->checkpoint);
+                    if (cp.offset == offset && cp.mode == checkpoint.mode) {
+                        change.num_old = size_t(old - back_.rbegin());
+                        shift(old, checkpoint, change.delta);
+                        break;
+                    }
+                }
+            }
+
+            front_.push_back({checkpoint, lexer.lex()});
+            if (eof_(front_.back().tok)) {
+                change.num_old = back_.size();
+                break;
+            }
+        }
+
+        change.num_new = front_.size() - first;
+        back_.erase(back_.end() - change.num_old, back_.end());
+        return change;
+    }
+    ///@}
+
+    /// @name Access
+    ///@{
+    size_t size() const { return front_.size() + back_.size(); }
+    const Tok& operator[](size_t i) const { return at(i).tok; }
+    /// The Lexer::Checkpoint in front of token @p i.
+    Checkpoint checkpoint(size_t i) const {
+        return i < front_.size() ? front_[i].checkpoint : absolute(at(i).checkpoint);
+    }
+    ///@}
+
+private:
+    using Back = typename std::vector<Entry>::reverse_iterator;
+
+    const Entry& at(size_t i) const {
+        return i < front_.size() ? front_[i] : back_[back_.size() - 1 - (i - front_.size())];
+    }
+
+    /// @name Gap
+    ///@{
+    /// Converts the Checkpoint of an Entry behind the gap into an absolute one and vice versa.
+    /// Unsigned arithmetic wraps around, so the relative offsets and rows may be "negative".
+    Checkpoint absolute(Checkpoint cp) const {
+        cp.offset += delta_;
+        cp.peek.row = uint16_t(cp.peek.row + rows_);
+        return cp;
+    }
+    Checkpoint relative(Checkpoint cp) const {
+        cp.offset -= delta_;
+        cp.peek.row = uint16_t(cp.peek.row - rows_);
+        return cp;
+    }
+
+    /// Index of the last Entry that is still sound after an edit at @p begin:
+    /// A token is unaffected by the edit, if neither its chars nor the lookahead at its end touch [begin, end).
+    size_t find(uint32_t begin) const {
+        static constexpr uint32_t Reach = uint32_t(L::Max_Ahead * utf8::Max);
+        auto touched = [](uint32_t begin, uint32_t offset) { return begin < offset + Reach; };
+        size_t res;
+        if (!front_.empty() && touched(begin, front_.back().checkpoint.offset)) {
+            res = size_t(std::upper_bound(front_.begin(), front_.end(), begin,
+                                          [&](uint32_t begin, const Entry& e) {
+                                              return touched(begin, e.checkpoint.offset);
+                                          })
+                         - front_.begin());
+        } else {
+            res = front_.size()
+                + size_t(std::upper_bound(back_.rbegin(), back_.rend(), begin,
+                                          [&](uint32_t begin, const Entry& e) {
+                                              return touched(begin, absolute(e.checkpoint).offset);
+                                          })
+                         - back_.rbegin());
+        }
+        return res != 0 ? res - 1 : 0;
+    }
+
+    /// Moves the gap in front of Entry @p i.
+    void seek(size_t i) {
+        for (; front_.size() > i; front_.pop_back()) {
+            auto& e      = front_.back();
+            e.checkpoint = relative(e.checkpoint);
+            back_.push_back(std::move(e));
+        }
+        for (; front_.size() < i && !back_.empty(); back_.pop_back()) {
+            auto& e      = back_.back();
+            e.checkpoint = absolute(e.checkpoint);
+            front_.push_back(std::move(e));
+        }
+    }
+
+    /// Moves all Checkpoint%s from @p sync on by @p delta bytes; @p to is the new Checkpoint for @p sync.
+    /// Rows shift uniformly via Relexer::rows_ - columns only within the row of @p sync, i.e. the rest of its line.
+    void shift(Back sync, const Checkpoint& to, int64_t delta) {
+        auto from = absolute(sync->checkpoint).peek;
+        for (auto i = sync; i != back_.rend() && absolute(i->checkpoint).peek.row == from.row; ++i)
+            i->checkpoint.peek.col = uint16_t(i->checkpoint.peek.col - from.col + to.peek.col);
+        delta_ = uint32_t(delta_ + delta);
+        rows_  = uint16_t(rows_ + to.peek.row - from.row);
+    }
+    ///@}
+
+    std::function<bool(const Tok&)> eof_;
+    std::vector<Entry> front_; ///< In front of the gap - with absolute Checkpoint%s.
+    std::vector<Entry> back_;  ///< Behind the gap - in *reverse* order and with Relexer::relative Checkpoint%s.
+    uint32_t delta_ = 0;       ///< Added to Checkpoint::offset behind the gap.
+    uint16_t rows_  = 0;       ///< Added to Pos::row behind the gap.
+};
+
+} // namespace fe
@@ -5,17 +5,19 @@
 #include <algorithm>
 #include <array>
 #include <initializer_list>
+#include <utility>
 
 #include <fe/assert.h>
 
 namespace fe {
 
 /// A ring buffer with @p N elements.
+/// Elements are moved - not copied - whenever possible; thus, `T` may also be move-only.
 template<class T, size_t N> class Ring {
 public:
     /// @name Construction
     ///@{
-    Ring(std::initializer_list<T> list) { std::copy(list.begin(), list.end(), array_); }
+    Ring(std::initializer_list<T> list) { std::copy(list.begin(), list.end(), array_.begin()); }
     Ring() noexcept   = default;
     Ring(const Ring&) = default;
     Ring(Ring&& other) noexcept
@@ -31,11 +33,11 @@ public:
     const T& front() const { return array_[first_]; }
     T& operator[](size_t i) {
         assert(i < N);
-        return array_[(first_ + i) % N];
+        return array_[wrap(first_ + i)];
     }
     const T& operator[](size_t i) const {
         assert(i < N);
-        return array_[(first_ + i) % N];
+        return array_[wrap(first_ + i)];
     }
     ///@}
 
@@ -43,11 +45,12 @@ public:
     ///@{
     void reset() { first_ = 0; }
 
-    T& put(const T& t) {
-        auto& res = array_[first_] = t;
-        first_                     = (first_ + 1) % N;
-        return res;
-    }
+    /// Overwrites Ring::front which then becomes the last element.
+    T& put(const T& t) { return advance() = t; }
+    T& put(T&& t) { return advance() = std::move(t); }
+    /// Same as `put(T(args...))`: As every slot always holds a live `T`, this move-assigns a temporary rather than
+    /// constructing in place.
+    template<class... Args> T& emplace(Args&&... args) { return advance() = T(std::forward<Args>(args)...); }
     ///@}
 
     friend void swap(Ring& r1, Ring& r2) noexcept {
@@ -57,6 +60,20 @@ public:
     }
 
 private:
+    /// @p i is in [0, 2N): a mask, if @p N is a power of two - one compare otherwise, which beats a division.
+    static constexpr size_t wrap(size_t i) {
+        if constexpr ((N & (N - 1)) == 0)
+            return i & (N - 1);
+        else
+            return i >= N ? i - N : i;
+    }
+
+    T& advance() {
+        auto& res = array_[first_];
+        first_    = wrap(first_ + 1);
+        return res;
+    }
+
     std::array<T, N> array_;
     size_t first_ = 0;
 };
@@ -95,6 +112,9 @@ public:
     ///@{
     void reset() {}
     T& put(const T& t) { return t_ = t; }
+    T& put(T&& t) { return t_ = std::move(t); }
+    /// Same as `put(T(args...))` - see Ring::emplace.
+    template<class... Args> T& emplace(Args&&... args) { return t_ = T(std::forward<Args>(args)...); }
     ///@}
 
     friend void swap(Ring& r1, Ring& r2) noexcept {
@@ -106,12 +126,12 @@ private:
     T t_;
 };
 
-/// Specialization if `N == 2`; doesn't need a ring, we just copy.
+/// Specialization if `N == 2`; doesn't need a ring, we just move.
 template<class T> class Ring<T, 2> {
 public:
     /// @name Construction
     ///@{
-    Ring(std::initializer_list<T> list) { std::copy(list.begin(), list.end(), array_); }
+    Ring(std::initializer_list<T> list) { std::copy(list.begin(), list.end(), array_.begin()); }
     Ring() noexcept   = default;
     Ring(const Ring&) = default;
     Ring(Ring&& other) noexcept
@@ -138,10 +158,14 @@ public:
     /// @name Modifiers
     ///@{
     void reset() {}
-    T& put(const T& t) {
-        array_[0]        = array_[1];
-        return array_[1] = t;
+    /// Copies @p t first, as it may refer to one of our elements - e.g. `ring.put(ring[1])`.
+    T& put(const T& t) { return put(T(t)); }
+    T& put(T&& t) {
+        array_[0]        = std::move(array_[1]);
+        return array_[1] = std::move(t);
     }
+    /// Same as `put(T(args...))` - see Ring::emplace.
+    template<class... Args> T& emplace(Args&&... args) { return put(T(std::forward<Args>(args)...)); }
     ///@}
 
     friend void swap(Ring& r1, Ring& r2) noexcept {
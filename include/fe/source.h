@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cstdint>
+
+#include <algorithm>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <span>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fe/loc.h"
+#include "fe/mmap.h"
+#include "fe/utf8.h"
+
+namespace fe {
+
+/// Compact Loc%ation: a half-open range [SLoc::begin, SLoc::end) of *global* byte offsets as handed out by a
+/// SourceManager.
+/// It's only a single machine word on a 64 bit arch and can address files with any number of lines.
+/// Resolve it with SourceManager::loc or SourceManager::print.
+/// @note Unlike Loc::finis, SLoc::end is one past the last byte.
+struct SLoc {
+    SLoc() = default; ///< Creates an invalid SLoc.
+    SLoc(uint32_t begin, uint32_t end)
+        : begin(begin)
+        , end(end) {}
+    SLoc(uint32_t pos)
+        : SLoc(pos, pos) {}
+
+    SLoc anew_begin() const { return {begin, begin}; }
+    SLoc anew_end() const { return {end, end}; }
+    SLoc operator+(SLoc loc) const { return {begin, loc.end}; }
+    explicit operator bool() const { return begin != 0; } ///< Is a valid SLoc?
+    bool operator==(const SLoc&) const = default;
+
+    uint32_t begin = 0;
+    uint32_t end   = 0;
+};
+
+/// Owns the contents of all source files and assigns each of them a disjoint range of global offsets.
+/// This allows to use SLoc instead of Loc: Row and column are only computed when you actually need them - e.g. in an
+/// error message - by a binary search in a line table which is built lazily per File.
+/// Use like this:
+/// ```
+/// fe::SourceManager sm;
+/// auto file = sm.load(path);
+/// if (!file) error("cannot read file '{}'", path);
+/// Lexer lexer(driver, file->span(), &file->path());
+/// // Within your Lexer:
+/// auto tok_loc = file->sloc(begin, offset());
+/// // ...
+/// std::cout << sm.str(tok_loc) << std::endl; // path:row:col-col
+/// ```
+/// @note Adding files is *not* thread-safe; resolving SLoc%s is.
+class SourceManager {
+public:
+    /// Row/column of an offset as 1-based numbers without Pos' 16-bit limit.
+    struct Pos32 {
+        uint32_t row = 0;
+        uint32_t col = 0;
+    };
+
+    class File {
+    public:
+        const std::filesystem::path& path() const { return path_; }
+        std::span<const char8_t> span() const { return {data_, size_}; }
+        uint32_t base() const { return base_; } ///< Global offset of this File's first byte.
+        uint32_t size() const { return uint32_t(size_); }
+        /// Does global @p offset belong to this File? The offset one past the last byte counts as well.
+        bool contains(uint32_t offset) const { return base_ <= offset && offset <= base_ + size_; }
+
+        /// SLoc for the *local* byte offsets [@p begin, @p end) - e.g. as obtained via Lexer::offset.
+        SLoc sloc(uint32_t begin, uint32_t end) const { return {base_ + begin, base_ + end}; }
+
+        /// 1-based row/column for *local* @p offset; the column counts code points, not bytes.
+        Pos32 pos(uint32_t offset) const {
+            std::call_once(once_, [this] { scan(); });
+            auto i   = std::upper_bound(lines_.begin(), lines_.end(), offset) - lines_.begin();
+            auto bol = lines_[i - 1];
+            return {uint32_t(i), uint32_t(1 + utf8::num_chars(data_ + bol, data_ + std::min(offset, size())))};
+        }
+
+        size_t num_lines() const {
+            std::call_once(once_, [this] { scan(); });
+            return lines_.size();
+        }
+
+    private:
+        /// Builds the line table: the local offset at which each line starts.
+        void scan() const {
+            lines_.emplace_back(0);
+            utf8::scan(data_, data_ + size_, '\n', [this](const char8_t* p) { lines_.emplace_back(p - data_ + 1); });
+        }
+
+        std::filesystem::path path_;
+        MMap mmap_;
+        std::u8string str_;
+        const char8_t* data_ = nullptr;
+        size_t size_         = 0;
+        uint32_t base_       = 0;
+        mutable std::once_flag once_;
+        mutable std::vector<uint32_t> lines_;
+
+        friend class SourceManager;
+    };
+
+    /// @name Construction
+    ///@{
+    SourceManager()                     = default;
+    SourceManager(const SourceManager&) = delete;
+    SourceManager& operator=(const SourceManager&) = delete;
+    ///@}
+
+    /// @name Add Files
+    ///@{
+    /// Memory-maps the file at @p path.
+    /// @returns `nullptr` if the file can't be read or the global offsets would exceed 32 bit.
+    const File* load(const std::filesystem::path& path) {
+        auto file   = std::make_unique<File>();
+        file->mmap_ = MMap(path);
+        if (!file->mmap_) return nullptr;
+        file->data_ = file->mmap_.data();
+        file->size_ = file->mmap_.size();
+        return insert(path, std::move(file));
+    }
+
+    /// Takes ownership of @p contents - e.g. for stdin or generated code.
+    const File* add(const std::filesystem::path& path, std::u8string contents) {
+        auto file   = std::make_unique<File>();
+        file->str_  = std::move(contents);
+        file->data_ = file->str_.data();
+        file->size_ = file->str_.size();
+        return insert(path, std::move(file));
+    }
+    ///@}
+
+    /// @name Lookup
+    ///@{
+    /// The File that contains global @p offset or `nullptr`.
+    const File* file(uint32_t offset) const {
+        auto i = std::upper_bound(files_.begin(), files_.end(), offset,
+                                  [](uint32_t offset, const auto& file) { return offset < file->base_; });
+        if (i == files_.begin() || !(*--i)->contains(offset)) return nullptr;
+        return i->get();
+    }
+    const File* file(SLoc loc) const { return file(loc.begin); }
+    size_t num_files() const { return files_.size(); }
+    ///@}
+
+    /// @name Resolve
+    ///@{
+    /// Converts @p loc to a classic Loc%ation; rows and columns beyond `0xffff` saturate.
+    /// The Loc::path points into this SourceManager.
+    Loc loc(SLoc loc) const {
+        auto file = this->file(loc);
+        if (!file) return {};
+        auto [b, f] = positions(*file, loc);
+        auto clamp  = [](uint32_t x) { return uint16_t(std::min(x, uint32_t(std::numeric_limits<uint16_t>::max()))); };
+        return {&file->path(), {clamp(b.row), clamp(b.col)}, {clamp(f.row), clamp(f.col)}};
+    }
+
+    /// Prints @p loc like `path:row:col-col` - just as Loc does but with full 32-bit rows/columns.
+    std::ostream& print(std::ostream& os, SLoc loc) const {
+        auto file = this->file(loc);
+        if (!file) return os << "<unknown location>";
+        auto [b, f] = positions(*file, loc);
+        os << file->path().string() << ':' << b.row << ':' << b.col;
+        if (b.row != f.row) return os << '-' << f.row << ':' << f.col;
+        if (b.col != f.col) return os << '-' << f.col;
+        return os;
+    }
+
+    std::string str(SLoc loc) const {
+        std::ostringstream oss;
+        print(oss, loc);
+        return oss.str();
+    }
+    ///@}
+
+private:
+    const File* insert(const std::filesystem::path& path, std::unique_ptr<File>&& file) {
+        // offset 0 is invalid; leave a gap of one between files so end offsets are unambiguous
+        uint64_t base = files_.empty() ? 1 : uint64_t(files_.back()->base_) + files_.back()->size_ + 1;
+        if (base + file->size_ > std::numeric_limits<uint32_t>::max()) return nullptr;
+        file->path_ = path;
+        file->base_ = uint32_t(base);
+        return files_.emplace_back(std::move(file)).get();
+    }
+
+    /// Positions of the first and the last code point of @p loc.
+    static std::pair<Pos32, Pos32> positions(const File& file, SLoc loc) {
+        auto begin = loc.begin - file.base_;
+        auto end   = loc.end - file.base_;
+        auto finis = begin;
+        if (end > begin) { // find begin of last code point
+            finis = end - 1;
+            while (finis > begin && (file.data_[finis] & 0b11000000) == 0b10000000) --finis;
+        }
+        return {file.pos(begin), file.pos(finis)};
+    }
+
+    std::vector<std::unique_ptr<File>> files_;
+};
+
+} // namespace fe
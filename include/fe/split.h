@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cstring>
+
+#include <algorithm>
+#include <functional>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "fe/assert.h"
+#include "fe/stream.h"
+
+namespace fe {
+
+/// Lexes a single huge buffer on several threads.
+/// The buffer is split into SplitLexer::Config::num_threads chunks right behind newlines,
+/// and each chunk is lexed speculatively into its own TokStream as if the Lexer was in its initial Lexer::Mode there.
+/// Afterwards, the chunks are stitched together in order:
+/// The Lexer of the previous chunk lexes just beyond the split point; if the Lexer::Checkpoint it ends with matches
+/// one of the first Lexer::Checkpoint%s of the speculation - i.e. the same offset, Pos%ition, and Lexer::Mode -,
+/// the chunk's tokens are taken from there on.
+/// Otherwise - e.g. because a block comment or a string spans the split point - the chunk is lexed once more
+/// from where the previous one ended.
+/// Since the row of each split point is counted up front, all Loc%s are the same as with a single Lexer.
+/// Use like this:
+/// ```
+/// fe::ConcurrentSymPool syms;
+/// fe::SplitLexer<Lexer> split(Tok::Tag::T_EoF, [&](std::span<const char8_t> buffer) {
+///     return Lexer(syms, buffer, &path); // invoked concurrently - so intern via a ConcurrentSymPool
+/// });
+/// fe::MMap mmap(path);
+/// auto toks = split.lex(mmap.span());
+/// Parser parser(driver, toks, &path); // a StreamParser
+/// ```
+/// @note Lexers of thrown away chunks may have issued diagnostics for input they saw in the wrong Lexer::Mode -
+/// e.g. an invalid character within what actually is a comment.
+/// Declare a split point as unsafe via SplitLexer::Config::safe, if this is a concern.
+/// @note Even if the speculation succeeds, the input between the split point and the matching Lexer::Checkpoint -
+/// usually the rest of a token, at most SplitLexer::Sync_Window bytes - is lexed twice: once by the previous chunk,
+/// whose tokens are kept, and once by the speculation, whose tokens are dropped.
+/// Hence, a diagnostic in there is issued twice - put a Filter in front of your Sink to drop the duplicates -,
+/// and with `FE_STATS`, Stats::Lexer counts these tokens, chars, and bytes twice.
+template<class L> class SplitLexer {
+public:
+    using Tok        = std::invoke_result_t<decltype(&L::lex), L&>;
+    using Tag        = decltype(std::declval<const Tok&>().tag());
+    using Checkpoint = std::invoke_result_t<decltype(&L::checkpoint), const L&>;
+
+    /// The previous chunk must line up with a token boundary of a speculation within this many bytes.
+    static constexpr size_t Sync_Window = 4096;
+
+    struct Config {
+        size_t num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+        size_t min_chunk   = 1024 * 1024; ///< Do not split into chunks smaller than this many bytes.
+        /// Is it safe to start lexing at @p offset - which is right behind a newline?
+        /// Return `false` if in your language a line starting like this probably continues a token - e.g. a
+        /// multi-line string.
+        /// Unset means: Every line is fine.
+        std::function<bool(std::span<const char8_t> buffer, size_t offset)> safe;
+    };
+
+    /// @name Construction
+    ///@{
+    /// @p eof is the Tag of the last token; @p mk builds an @p L from a `std::span<const char8_t>`.
+    /// @warning @p mk is invoked concurrently.
+    SplitLexer(Tag eof, std::function<L(std::span<const char8_t>)> mk, Config config = {})
+        : eof_(eof)
+        , mk_(std::move(mk))
+        , config_(std::move(config)) {}
+    ///@}
+
+    /// @name Lex
+    ///@{
+    /// Lexes all of @p buffer up to and including the first @p eof token.
+    TokStream<Tok, Tag> lex(std::span<const char8_t> buffer) {
+        auto splits = split(buffer);
+        auto n      = splits.size() - 1;
+        std::vector<Chunk> chunks(n);
+        num_relexed_ = 0;
+
+        // row of each split point: count the newlines of each chunk in parallel, then sum them up
+        if constexpr (L::Track_Pos) {
+            std::vector<size_t> newlines(n);
+            run(n, [&](size_t i) {
+                newlines[i] = std::count(buffer.begin() + splits[i], buffer.begin() + splits[i + 1], u8'\n');
+            });
+            for (size_t i = 1, rows = 0; i != n; ++i) chunks[i].row = uint16_t(1 + (rows += newlines[i - 1]));
+        }
+
+        run(n, [&](size_t i) {
+            auto& chunk = chunks[i];
+            auto lexer  = mk_(buffer);
+            if (i != 0) {
+                // guess: the Lexer is in its initial Lexer::Mode at the beginning of a line
+                auto begin   = lexer.checkpoint();
+                begin.offset = uint32_t(splits[i]);
+                if constexpr (L::Track_Pos) begin.peek = Pos(chunk.row, 1);
+                lexer.restore(begin);
+            }
+            chunk.end = lex(lexer, chunk.toks, i + 1 == n ? buffer.size() + 1 : splits[i + 1], &chunk.sync);
+        });
+
+        // stitch
+        auto res = std::move(chunks.front().toks);
+        auto end = chunks.front().end;
+        for (size_t i = 1; i != n && !eof(res); ++i) {
+            auto& sync = chunks[i].sync;
+            auto j     = std::lower_bound(sync.begin(), sync.end(), end.offset,
+                                          [](const Checkpoint& cp, uint32_t offset) { return cp.offset < offset; });
+            if (j != sync.end() && *j == end) {
+                res.append(chunks[i].toks, size_t(j - sync.begin()));
+                end = chunks[i].end;
+            } else {
+                ++num_relexed_;
+                auto lexer = mk_(buffer);
+                lexer.restore(end);
+                end = lex(lexer, res, i + 1 == n ? buffer.size() + 1 : splits[i + 1]);
+            }
+        }
+        num_chunks_ = n;
+        return res;
+    }
+    ///@}
+
+    /// @name Getters
+    ///@{
+    /// About the last SplitLexer::lex:
+    size_t num_chunks() const { return num_chunks_; }   ///< Number of chunks the buffer has been split into.
+    size_t num_relexed() const { return num_relexed_; } ///< Number of chunks whose speculation failed.
+    const Config& config() const { return config_; }
+    ///@}
+
+private:
+    struct Chunk {
+        TokStream<Tok, Tag> toks;
+        std::vector<Checkpoint> sync; ///< In front of the first tokens - within Sync_Window.
+        Checkpoint end;
+        uint16_t row = 1;
+    };
+
+    /// Begins of the chunks - followed by the size of @p buffer.
+    std::vector<size_t> split(std::span<const char8_t> buffer) const {
+        auto size = buffer.size();
+        auto n    = std::max(std::min(config_.num_threads, size / std::max(config_.min_chunk, size_t(1))), size_t(1));
+        std::vector<size_t> res = {0};
+        for (size_t i = 1; i != n; ++i) {
+            auto limit = (i + 1) * size / n;
+            for (auto offset = std::max(i * size / n, res.back() + 1); offset < limit;) {
+                auto nl = (const char8_t*)std::memchr(buffer.data() + offset, '\n', limit - offset);
+                if (nl == nullptr) break;
+                offset = size_t(nl - buffer.data()) + 1;
+                if (offset != size && (!config_.safe || config_.safe(buffer, offset))) {
+                    res.emplace_back(offset);
+                    break;
+                }
+            }
+        }
+        res.emplace_back(size);
+        return res;
+    }
+
+    /// Lexes from @p lexer into @p toks until the @p eof token or a token boundary at/behind @p limit.
+    /// Records the Checkpoint%s of the first tokens in @p sync, if given.
+    /// @returns the Checkpoint there.
+    Checkpoint lex(L& lexer, TokStream<Tok, Tag>& toks, size_t limit, std::vector<Checkpoint>* sync = nullptr) {
+        auto window = lexer.checkpoint().offset + Sync_Window;
+        while (true) {
+            auto checkpoint = lexer.checkpoint();
+            if (checkpoint.offset >= limit) return checkpoint;
+            if (sync && checkpoint.offset <= window) sync->emplace_back(checkpoint);
+            toks.push_back(lexer.lex());
+            if (eof(toks)) return checkpoint;
+        }
+    }
+
+    bool eof(const TokStream<Tok, Tag>& toks) const { return !toks.empty() && toks.tag(toks.size() - 1) == eof_; }
+
+    /// Invokes @p f with `0, ..., n-1` - each on its own thread, but the first one on the calling thread.
+    template<class F> static void run(size_t n, F f) {
+        std::vector<std::jthread> threads;
+        for (size_t i = 1; i < n; ++i) threads.emplace_back(f, i);
+        f(0);
+    }
+
+    Tag eof_;
+    std::function<L(std::span<const char8_t>)> mk_;
+    Config config_;
+    size_t num_chunks_  = 0;
+    size_t num_relexed_ = 0;
+};
+
+} // namespace fe
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstdint>
+
+#include <chrono>
+#include <format>
+#include <mutex>
+#include <ostream>
+#include <type_traits>
+
+namespace fe {
+
+/// Is fe built with the `FE_STATS` CMake option - i.e. do Lexer, Parser, Arena, and SymPool count what they do?
+#ifdef FE_STATS
+inline constexpr bool Enable_Stats = true;
+#else
+inline constexpr bool Enable_Stats = false;
+#endif
+
+/// Counters to size Arena%s and to decide on `FE_ABSL` per deployment.
+/// Only filled if fe::Enable_Stats; otherwise, the counting code is not even compiled in and everything here stays 0.
+/// * Lexer, Parser, and Arena record into Stats::global upon destruction.
+/// * SymPool keeps its own Stats::Sym; Driver::stats adds those of the Driver itself.
+///
+/// Use like this:
+/// ```
+/// driver.stats().dump(std::cerr);
+/// ```
+struct Stats {
+    struct Lexer {
+        /// Lexer::start%s before the EoF - i.e. tokens plus the restarts after skipping whitespace or comments,
+        /// if your Lexer invokes Lexer::start for those, too; Stats::Parser::fills counts tokens only.
+        uint64_t tokens = 0;
+        uint64_t chars  = 0; ///< Unicode code points.
+        uint64_t bytes  = 0;
+        /// From construction to the first Lexer::start at the EoF - which includes the time the Parser spent in
+        /// between.
+        std::chrono::nanoseconds time{0};
+
+        Lexer& operator+=(const Lexer& other) {
+            // clang-format off
+            tokens += other.tokens;
+            chars  += other.chars;
+            bytes  += other.bytes;
+            time   += other.time;
+            // clang-format on
+            return *this;
+        }
+    };
+
+    struct Parser {
+        uint64_t fills   = 0; ///< Tokens pulled from the Lexer into the lookahead.
+        uint64_t replays = 0; ///< Tokens replayed from the buffer after a Parser::rewind.
+
+        Parser& operator+=(const Parser& other) {
+            fills += other.fills;
+            replays += other.replays;
+            return *this;
+        }
+    };
+
+    struct Arena {
+        uint64_t pages       = 0; ///< Pages obtained from the system or the Arena::PagePool.
+        uint64_t large       = 0; ///< Allocations that went into the large object list.
+        uint64_t allocations = 0;
+        uint64_t reserved    = 0; ///< Bytes of all pages and large objects ever obtained.
+        uint64_t used        = 0; ///< Bytes handed out via Arena::allocate - excluding alignment padding.
+        uint64_t waste       = 0; ///< Bytes left at the end of a page upon a page switch.
+
+        Arena& operator+=(const Arena& other) {
+            // clang-format off
+            pages       += other.pages;
+            large       += other.large;
+            allocations += other.allocations;
+            reserved    += other.reserved;
+            used        += other.used;
+            waste       += other.waste;
+            // clang-format on
+            return *this;
+        }
+    };
+
+    struct Sym {
+        uint64_t lookups    = 0; ///< Calls of SymPool::sym with a non-empty string.
+        uint64_t hits       = 0; ///< ... that found an already interned String.
+        uint64_t packed     = 0; ///< ... that were short enough to be packed into the Sym itself.
+        uint64_t collisions = 0; ///< Insertions into an already occupied bucket; not available with `FE_ABSL`.
+
+        Sym& operator+=(const Sym& other) {
+            // clang-format off
+            lookups    += other.lookups;
+            hits       += other.hits;
+            packed     += other.packed;
+            collisions += other.collisions;
+            // clang-format on
+            return *this;
+        }
+    };
+
+    Lexer lexer;
+    Parser parser;
+    Arena arena;
+    Sym sym;
+
+    Stats& operator+=(const Stats& other) {
+        lexer += other.lexer;
+        parser += other.parser;
+        arena += other.arena;
+        sym += other.sym;
+        return *this;
+    }
+    friend Stats operator+(Stats s1, const Stats& s2) { return s1 += s2; }
+
+    /// @name Global
+    ///@{
+    /// Thread-safe; you rarely need these directly - see Driver::stats.
+    static Stats global() {
+        auto lock = std::lock_guard(mutex());
+        return instance();
+    }
+    template<class T> static void record(const T& stats) {
+        auto lock = std::lock_guard(mutex());
+        // clang-format off
+        if constexpr (std::is_same_v<T, Lexer >) instance().lexer  += stats;
+        if constexpr (std::is_same_v<T, Parser>) instance().parser += stats;
+        if constexpr (std::is_same_v<T, Arena >) instance().arena  += stats;
+        if constexpr (std::is_same_v<T, Sym   >) instance().sym    += stats;
+        if constexpr (std::is_same_v<T, Stats >) instance()        += stats;
+        // clang-format on
+    }
+    static void clear_global() {
+        auto lock  = std::lock_guard(mutex());
+        instance() = {};
+    }
+    ///@}
+
+    /// Prints the counters together with some derived rates.
+    void dump(std::ostream& os) const {
+        auto pct = [](uint64_t n, uint64_t d) { return d == 0 ? 0 : n * 100 / d; };
+        auto ns  = uint64_t(lexer.time.count());
+        if (!Enable_Stats) os << "fe was built without FE_STATS - all counters are 0\n";
+        os << std::format("lexer:  {} tokens, {} chars, {} bytes in {} us ({} tokens/s)\n", lexer.tokens,
+                          lexer.chars, lexer.bytes, ns / 1000, ns == 0 ? 0 : lexer.tokens * 1'000'000'000 / ns);
+        os << std::format("parser: {} lookahead fills, {} replays\n", parser.fills, parser.replays);
+        os << std::format("arena:  {} pages, {} large, {} allocations; {} bytes reserved, {} used ({}%), {} waste\n",
+                          arena.pages, arena.large, arena.allocations, arena.reserved, arena.used,
+                          pct(arena.used, arena.reserved), arena.waste);
+        os << std::format("sym:    {} lookups, {}% hits, {}% packed, {} collisions\n", sym.lookups,
+                          pct(sym.hits, sym.lookups), pct(sym.packed, sym.lookups), sym.collisions);
+    }
+
+private:
+    static std::mutex& mutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+    static Stats& instance() {
+        static Stats stats;
+        return stats;
+    }
+};
+
+} // namespace fe
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <initializer_list>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "fe/assert.h"
+#include "fe/loc.h"
+#include "fe/parser.h"
+
+namespace fe {
+
+/// All `Tok`ens of a file - lexed up front - as two parallel arrays:
+/// 1. the tags as bytes,
+/// 2. the `Tok`ens themselves.
+///
+/// This is only half a [structure of arrays](https://en.wikipedia.org/wiki/AoS_and_SoA): `Tok` is opaque to fe, so
+/// its Loc%ation and payload stay together in the second array, and TokStream::loc reads from there.
+/// Scans that only look at tags - e.g. skipping to the next `;` after a syntax error or finding the matching `)` -
+/// are tight loops over a dense `uint8_t` array; StreamParser only touches a `Tok` when it actually consumes it.
+/// Since a TokStream is a plain value, lexing and parsing become separate stages that may run on different threads:
+/// e.g. lex the next file while parsing the current one.
+/// Use like this:
+/// ```
+/// Lexer lexer(driver, buffer, &path);
+/// fe::TokStream<Tok, Tok::Tag> toks(lexer, Tok::Tag::T_EoF);
+/// Parser parser(driver, toks, &path); // a StreamParser
+/// ```
+/// @p Tag must be an enum whose values fit into a byte.
+template<class Tok, class Tag> class TokStream {
+public:
+    /// @name Construction
+    ///@{
+    TokStream() = default;
+    /// Lexes everything from @p lexer up to and including the first @p eof token.
+    template<class L> TokStream(L& lexer, Tag eof) { lex(lexer, eof); }
+
+    /// Appends everything from @p lexer up to and including the first @p eof token.
+    template<class L> void lex(L& lexer, Tag eof) {
+        while (true) {
+            auto tok = lexer.lex();
+            push_back(tok);
+            if (tok.tag() == eof) return;
+        }
+    }
+
+    void push_back(const Tok& tok) {
+        assert(size_t(tok.tag()) < 256 && "tag does not fit into a byte");
+        tags_.push_back(uint8_t(tok.tag()));
+        toks_.push_back(tok);
+    }
+
+    /// Appends the tokens of @p other from index @p from on - e.g. the next chunk lexed by fe::SplitLexer.
+    void append(const TokStream& other, size_t from = 0) {
+        assert(from <= other.size());
+        tags_.insert(tags_.end(), other.tags_.begin() + from, other.tags_.end());
+        toks_.insert(toks_.end(), other.toks_.begin() + from, other.toks_.end());
+    }
+
+    void reserve(size_t n) {
+        tags_.reserve(n);
+        toks_.reserve(n);
+    }
+
+    void clear() {
+        tags_.clear();
+        toks_.clear();
+    }
+    ///@}
+
+    /// @name Access
+    ///@{
+    size_t size() const { return tags_.size(); }
+    bool empty() const { return tags_.empty(); }
+    Tag tag(size_t i) const { return Tag(tags_[i]); }
+    Loc loc(size_t i) const { return toks_[i].loc(); }
+    const Tok& operator[](size_t i) const { return toks_[i]; }
+
+    std::span<const uint8_t> tags() const { return tags_; }
+    std::span<const Tok> toks() const { return toks_; }
+    ///@}
+
+    /// @name Scan
+    ///@{
+    /// @returns the index of the first token at or behind @p from with @p tag or TokStream::size, if there is none.
+    size_t find(Tag tag, size_t from = 0) const {
+        if (from >= size()) return size();
+        auto p = (const uint8_t*)std::memchr(tags_.data() + from, int(tag), size() - from);
+        return p ? size_t(p - tags_.data()) : size();
+    }
+
+    /// Same as above but stops at any of @p tags - e.g. the synchronization set for error recovery.
+    size_t find(std::initializer_list<Tag> tags, size_t from = 0) const {
+        std::array<bool, 256> set = {};
+        for (auto tag : tags) set[size_t(tag)] = true;
+        for (size_t i = from, e = size(); i < e; ++i)
+            if (set[tags_[i]]) return i;
+        return size();
+    }
+
+    /// Token @p i must be an @p open token; finds the matching @p close token while skipping nested pairs.
+    /// @returns TokStream::size, if there is none.
+    size_t match(size_t i, Tag open, Tag close) const {
+        assert(tag(i) == open && open != close);
+        size_t depth = 0;
+        for (size_t e = size(); i < e; ++i) {
+            if (tags_[i] == uint8_t(open))
+                ++depth;
+            else if (tags_[i] == uint8_t(close) && --depth == 0)
+                return i;
+        }
+        return size();
+    }
+
+    size_t count(Tag tag) const { return std::count(tags_.begin(), tags_.end(), uint8_t(tag)); }
+    ///@}
+
+private:
+    std::vector<uint8_t> tags_;
+    std::vector<Tok> toks_;
+};
+
+/// Like Parser but reads from a TokStream instead of pulling `Tok`ens from a Lexer.
+/// Thus, the lookahead is unbounded, StreamParser::ahead is merely an array access, and a Mark is merely an index.
+/// Instead of `lexer()`, @p S has to provide a `syntax_err` only.
+template<class Tok, class Tag, class S> class StreamParser {
+private:
+    S& self() { return *static_cast<S*>(this); }
+    const S& self() const { return *static_cast<const S*>(this); }
+
+protected:
+    /// @name Construction
+    ///@{
+    /// @p stream must end with the EoF token and outlive this StreamParser.
+    void init(const TokStream<Tok, Tag>& stream, const std::filesystem::path* path) {
+        assert(!stream.empty());
+        stream_ = &stream;
+        pos_    = 0;
+        prev_   = Loc(path, {1, 1});
+    }
+    ///@}
+
+    /// @name Track Loc%ation in Source File
+    ///@{
+    using Tracker = fe::Tracker;
+
+    /// Factory method to build a Tracker.
+    Tracker tracker() { return {prev_, stream_->loc(index(0)).begin}; }
+    ///@}
+
+    /// @name Shift Token
+    ///@{
+    /// Get lookahead; looking beyond the EoF token yields the EoF token.
+    const Tok& ahead(size_t i = 0) const { return (*stream_)[index(i)]; }
+    /// Only the tag of StreamParser::ahead.
+    Tag ahead_tag(size_t i = 0) const { return stream_->tag(index(i)); }
+
+    /// Next Token; stays at the EoF token once arrived there.
+    Tok lex() {
+        auto& result = ahead();
+        prev_        = result.loc();
+        if (pos_ + 1 != stream_->size()) ++pos_;
+        return result;
+    }
+
+    /// If StreamParser::ahead() is a @p tag, consume and return it, otherwise yield `std::nullopt`.
+    std::optional<Tok> accept(Tag tag) {
+        if (tag != ahead_tag()) return {};
+        return lex();
+    }
+
+    /// StreamParser::lex StreamParser::ahead() which must be a @p tag.
+    /// Issue error with @p ctxt otherwise.
+    Tok expect(Tag tag, std::string_view ctxt) {
+        if (ahead_tag() == tag) return lex();
+        self().syntax_err(tag, ctxt);
+        return {};
+    }
+
+    /// Consume StreamParser::ahead which must be a @p tag; asserts otherwise.
+    Tok eat([[maybe_unused]] Tag tag) {
+        assert(tag == ahead_tag() && "internal parser error");
+        return lex();
+    }
+
+    /// Error recovery: Skips everything up to - but excluding - the next token with any of @p tags or the EoF token.
+    void skip_to(std::initializer_list<Tag> tags) {
+        auto i = std::min(stream_->find(tags, pos_), stream_->size() - 1);
+        if (i == pos_) return;
+        pos_  = i;
+        prev_ = stream_->loc(i - 1);
+    }
+    ///@}
+
+    /// @name Speculation
+    ///@{
+    /// Same as Parser::mark & friends - but as all tokens are already there, these are mere index operations.
+    struct Mark {
+        size_t pos;
+        Loc prev;
+    };
+
+    Mark mark() const { return {pos_, prev_}; }
+    void rewind(const Mark& mark) { pos_ = mark.pos, prev_ = mark.prev; }
+    void commit(const Mark&) {}
+
+    template<class R> using Memo = std::unordered_map<size_t, std::pair<R, Mark>>;
+
+    /// Same as Parser::memoize - but without an active Mark, it memoizes nevertheless.
+    template<class R, class F> R memoize(Memo<R>& memo, F f) {
+        auto key = pos_;
+        if (auto i = memo.find(key); i != memo.end()) {
+            auto& [res, end] = i->second;
+            rewind(end);
+            return res;
+        }
+
+        auto res = f();
+        memo.insert_or_assign(key, std::pair(res, mark()));
+        return res;
+    }
+    ///@}
+
+    /// @name Getters
+    ///@{
+    const TokStream<Tok, Tag>& stream() const { return *stream_; }
+    size_t pos() const { return pos_; } ///< Index of StreamParser::ahead() within StreamParser::stream.
+    ///@}
+
+    Loc prev_;
+
+private:
+    size_t index(size_t i) const { return std::min(pos_ + i, stream_->size() - 1); }
+
+    const TokStream<Tok, Tag>* stream_ = nullptr;
+    size_t pos_                        = 0;
+};
+
+} // namespace fe
@@ -1,21 +1,33 @@
 #pragma once
 
 #include <cassert>
+#include <cstddef>
 #include <cstring>
 
+#include <algorithm>
+#include <atomic>
 #include <bit>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 #ifdef FE_ABSL
 #    include <absl/container/flat_hash_map.h>
 #    include <absl/container/flat_hash_set.h>
 #else
-#    include <unordered_map>
 #    include <unordered_set>
 #endif
 
 #include "fe/arena.h"
+#include "fe/flat.h"
+#include "fe/fold.h"
+#include "fe/stats.h"
 
 static_assert(std::endian::native == std::endian::little || std::endian::native == std::endian::big,
               "mixed endianess not supported");
@@ -42,39 +54,103 @@ public:
     static constexpr size_t Short_String_Mask  = Short_String_Bytes - 1;
 
     struct String {
+        /// A `std::string_view` together with its hash - so we only compute it once.
+        struct Key {
+            Key(std::string_view view)
+                : view(view)
+                , hash(Hash()(view)) {}
+
+            std::string_view view;
+            size_t hash;
+        };
+
+        static constexpr uint32_t No_Ordinal = uint32_t(-1);
+
         String() noexcept = default;
-        String(size_t size)
-            : size(size) {}
+        String(size_t size, size_t hash)
+            : size(uint32_t(size))
+            , hash(hash) {}
+
+        std::string_view view() const { return {chars, size}; }
+
+        /// Copies @p key as null-terminated String into @p arena.
+        /// @throws std::length_error if @p key does not fit into String::size - i.e. is 4 GiB or more.
+        static const String* mk(Arena& arena, Key key) {
+            auto s = key.view;
+            if (s.size() > std::numeric_limits<uint32_t>::max()) throw std::length_error("fe::Sym: string too long");
+            auto ptr = (String*)arena.align(Short_String_Bytes).allocate(sizeof(String) + s.size() + 1 /*'\0'*/);
+            new (ptr) String(s.size(), key.hash);
+            *std::copy(s.begin(), s.end(), ptr->chars) = '\0';
+            return ptr;
+        }
 
-        size_t size;
+        uint32_t size;
+        mutable uint32_t ordinal = No_Ordinal; ///< See SymPool::ordinal.
+        size_t hash; ///< Cached, so neither probing nor rehashing the pool needs to touch the chars.
         char chars[]; // This is actually a C-only features, but all C++ compilers support that anyway.
 
+        /// @name Hash/Equal
+        ///@{
+        /// Both are [transparent](https://en.cppreference.com/w/cpp/utility/functional#Transparent_function_objects):
+        /// This allows SymPool::sym to look up a Key without copying it into the arena first.
+        /// Equal first compares the (cached) hashes, then the sizes, and only then the chars via `memcmp`.
         struct Equal {
+            using is_transparent = void;
+
+            static bool eq(size_t h1, size_t h2, std::string_view s1, std::string_view s2) {
+                return h1 == h2 && s1.size() == s2.size() && std::memcmp(s1.data(), s2.data(), s1.size()) == 0;
+            }
+
             bool operator()(const String* s1, const String* s2) const {
-                bool res = s1->size == s2->size;
-                for (size_t i = 0, e = s1->size; res && i != e; ++i) res &= s1->chars[i] == s2->chars[i];
-                return res;
+                return s1 == s2 || eq(s1->hash, s2->hash, s1->view(), s2->view());
             }
+            bool operator()(const String* s1, Key k2) const { return eq(s1->hash, k2.hash, s1->view(), k2.view); }
+            bool operator()(Key k1, const String* s2) const { return eq(k1.hash, s2->hash, k1.view, s2->view()); }
         };
 
         struct Hash {
-            size_t operator()(const String* s) const {
-                return std::hash<std::string_view>()(std::string_view(s->chars, s->size));
-            }
-        };
+            using is_transparent = void;
 
 #ifdef FE_ABSL
-        template<class H> friend H AbslHashValue(H h, const String* string) {
-            return H::combine(std::move(h), std::string_view(string->chars, string->size));
-        }
+            size_t operator()(std::string_view s) const { return absl::Hash<std::string_view>()(s); }
+#else
+            size_t operator()(std::string_view s) const { return std::hash<std::string_view>()(s); }
 #endif
+            size_t operator()(Key key) const { return key.hash; }
+            size_t operator()(const String* s) const { return s->hash; }
+        };
+        ///@}
     };
 
-    static_assert(sizeof(String) == sizeof(size_t), "String.chars should be 0");
+    // 16 bytes on 64-bit targets, 12 on 32-bit ones
+    static_assert(sizeof(String) % alignof(size_t) == 0 && offsetof(String, chars) == sizeof(String),
+                  "String.chars should be 0");
 
 private:
     Sym(uintptr_t ptr)
         : ptr_(ptr) {}
+    Sym(const String* string)
+        : ptr_((uintptr_t)string) {}
+
+    /// Does a string of @p size chars fit into Sym::ptr_? We need two more bytes for `\0' and the size.
+    static constexpr bool is_short(size_t size) { return size <= Short_String_Bytes - 2; }
+
+    /// Is this Sym%bol either empty or Sym::pack%ed - i.e. not backed by a String?
+    bool is_packed() const { return ptr_ == 0 || (ptr_ & Short_String_Mask) != 0; }
+
+    /// Packs @p s - which must be Sym::is_short - directly into Sym::ptr_.
+    static Sym pack(std::string_view s) {
+        auto size     = s.size();
+        uintptr_t ptr = size;
+        // Little endian: 2 a b 0 register: 0ba2
+        // Big endian:    a b 0 2 register: ab02
+        if constexpr (std::endian::native == std::endian::little)
+            for (uintptr_t i = 0, shift = 8; i != size; ++i, shift += 8) ptr |= (uintptr_t(s[i]) << shift);
+        else
+            for (uintptr_t i = 0, shift = (Short_String_Bytes - 1) * 8; i != size; ++i, shift -= 8)
+                ptr |= (uintptr_t(s[i]) << shift);
+        return Sym(ptr);
+    }
 
 public:
     Sym() noexcept = default;
@@ -163,13 +239,14 @@ private:
     uintptr_t ptr_ = 0;
 
     friend class SymPool;
+    friend class ConcurrentSymPool;
 };
 
 #ifndef DOXYGEN
 } // namespace fe
 
 template<> struct std::hash<fe::Sym> {
-    size_t operator()(fe::Sym sym) const { return std::hash<uintptr_t>()(sym.ptr_); }
+    size_t operator()(fe::Sym sym) const { return size_t(fe::mix(sym.ptr_)); } ///< Not the identity - see fe::mix.
 };
 
 namespace fe {
@@ -178,13 +255,22 @@ namespace fe {
 /// @name Sym
 ///@{
 /// Set/Map is keyed by pointer - which is hashed in SymPool.
+/// Without Abseil, they are FlatMap/FlatSet. Either way, you can pass an Arena::Allocator:
+/// ```
+/// fe::SymMap<int, fe::Arena::Allocator<std::pair<fe::Sym, int>>> map(arena.allocator<std::pair<fe::Sym, int>>());
+/// ```
 #ifdef FE_ABSL
-template<class V> using SymMap = absl::flat_hash_map<Sym, V>;
-using SymSet                   = absl::flat_hash_set<Sym>;
+template<class V, class A = std::allocator<std::pair<const Sym, V>>>
+using SymMap = absl::flat_hash_map<Sym, V, absl::Hash<Sym>, std::equal_to<Sym>, A>;
+template<class A = std::allocator<Sym>>
+using SymSetOf = absl::flat_hash_set<Sym, absl::Hash<Sym>, std::equal_to<Sym>, A>;
 #else
-template<class V> using SymMap = std::unordered_map<Sym, V>;
-using SymSet                   = std::unordered_set<Sym>;
+template<class V, class A = std::allocator<std::pair<Sym, V>>>
+using SymMap = FlatMap<Sym, V, std::hash<Sym>, std::equal_to<Sym>, A>;
+template<class A = std::allocator<Sym>>
+using SymSetOf = FlatSet<Sym, std::hash<Sym>, std::equal_to<Sym>, A>;
 #endif
+using SymSet = SymSetOf<>;
 ///@}
 
 /// Hash set where all strings - wrapped in Sym%bol - live in.
@@ -213,54 +299,688 @@ public:
     ///@{
     Sym sym(std::string_view s) {
         if (s.empty()) return Sym();
-        auto size = s.size();
-
-        if (size <= Sym::Short_String_Bytes - 2) { // small string: need two more bytes for `\0' and size
-            uintptr_t ptr = size;
-            // Little endian: 2 a b 0 register: 0ba2
-            // Big endian:    a b 0 2 register: ab02
-            if constexpr (std::endian::native == std::endian::little)
-                for (uintptr_t i = 0, shift = 8; i != size; ++i, shift += 8) ptr |= (uintptr_t(s[i]) << shift);
-            else
-                for (uintptr_t i = 0, shift = (Sym::Short_String_Bytes - 1) * 8; i != size; ++i, shift -= 8)
-                    ptr |= (uintptr_t(s[i]) << shift);
-            return Sym(ptr);
+#ifdef FE_STATS
+        ++stats_.lookups;
+        if (Sym::is_short(s.size())) ++stats_.packed;
+#endif
+        if (Sym::is_short(s.size())) return Sym::pack(s);
+
+        auto key = String::Key(s);
+        auto str = image_.find(key);
+        if (!str)
+            if (auto i = pool_.find(key); i != pool_.end()) str = *i;
+        if (!str) str = find_in_epochs(key);
+        if (str) {
+#ifdef FE_STATS
+            ++stats_.hits;
+#endif
+            return str;
         }
 
-        auto state = strings_.state();
-        auto ptr   = (String*)strings_.align(Sym::Short_String_Bytes).allocate(sizeof(String) + s.size() + 1 /*'\0'*/);
-        new (ptr) String(s.size());
-        *std::copy(s.begin(), s.end(), ptr->chars) = '\0';
-        auto [i, ins]                              = pool_.emplace(ptr);
-        if (ins) return Sym((uintptr_t)ptr);
-        strings_.deallocate(state);
-        return Sym((uintptr_t)*i);
+        if (epoch_ != Pinned) return insert(epochs_.back()->strings, epochs_.back()->pool, key);
+        return insert(strings_, pool_, key);
     }
     Sym sym(const std::string& s) { return sym((std::string_view)s); }
     /// @p s is a null-terminated C-string.
     Sym sym(const char* s) { return s == nullptr || *s == '\0' ? Sym() : sym(std::string_view(s, strlen(s))); }
     // TODO we can try to fit s in current page and hence eliminate the explicit use of strlen
+
+    /// Interns the case folding of @p s - see utf8::fold - for case-insensitive languages like FORTRAN or SQL:
+    /// `sym_fold("Foo") == sym_fold("FOO")`, and both are spelled `foo`.
+    /// @p s is folded into a buffer on the stack and only copied into the SymPool if it is new.
+    /// Hence, in contrast to Lexer::Append::Lower, your Lexer can keep its zero-copy spelling:
+    /// ```
+    /// while (accept(utf8::isxidcontinue)) {}
+    /// return {loc_, driver_.sym_fold(str())};
+    /// ```
+    Sym sym_fold(std::string_view s) {
+        return utf8::fold(s, [this](std::string_view folded) { return sym(folded); });
+    }
+    ///@}
+
+    /// @name Snapshot
+    ///@{
+    /// Serializes all Sym%bols - and a hash index for them - into a relocatable binary image.
+    /// SymPool::load lets another process start with all of them already interned.
+    /// Use like this:
+    /// ```
+    /// // once - e.g. when building the prelude
+    /// std::ofstream ofs("prelude.syms", std::ios::binary);
+    /// driver.sym_pool().dump(ofs);
+    ///
+    /// // each process start
+    /// fe::MMap mmap("prelude.syms");
+    /// fe::SymPool syms;
+    /// if (!mmap || !syms.load(mmap.span())) { /* intern prelude the slow way */ }
+    /// ```
+    /// @note The image stores the hashes of String::Hash; it is only meaningful for the same build of fe.
+    /// @note SymPool::ordinal%s are renumbered: The image's Sym%bols get `0, ..., n-1` in the loading SymPool.
+    void dump(std::ostream& os) const {
+        std::vector<const String*> strs;
+        strs.reserve(size());
+        image_.for_each([&](const String* str) { strs.emplace_back(str); });
+        for (auto str : pool_) strs.emplace_back(str);
+        for (auto& gen : epochs_)
+            for (auto str : gen->pool) strs.emplace_back(str);
+
+        Image::Header header{
+            .magic       = Image::Magic,
+            .probe       = Image::probe(),
+            .num_strings = strs.size(),
+            .capacity    = std::bit_ceil(std::max(2 * strs.size(), Image::Min_Capacity)),
+            .size        = 0,
+        };
+
+        // layout: Header | uint64_t index[capacity] | String records - each aligned to Short_String_Bytes
+        std::vector<uint64_t> index(header.capacity, 0);
+        uint64_t offset = sizeof(Image::Header) + header.capacity * sizeof(uint64_t);
+        for (auto str : strs) {
+            for (auto i = str->hash & (header.capacity - 1);; i = (i + 1) & (header.capacity - 1)) {
+                if (index[i] == 0) {
+                    index[i] = offset;
+                    break;
+                }
+            }
+            offset += Image::record_size(str);
+        }
+        header.size = offset;
+
+        os.write((const char*)&header, sizeof(header));
+        os.write((const char*)index.data(), std::streamsize(index.size() * sizeof(uint64_t)));
+        for (uint32_t ord = 0; auto str : strs) {
+            auto record    = String(str->size, str->hash);
+            record.ordinal = ord++; // the image's Strings are the loading SymPool's first ordinals
+            os.write((const char*)&record, sizeof(String));
+            os.write(str->chars, std::streamsize(str->size + 1));
+            for (auto pad = sizeof(String) + str->size + 1, n = Image::record_size(str); pad != n; ++pad) os.put('\0');
+        }
+    }
+
+    /// Makes all Sym%bols of @p image - as produced by SymPool::dump - available without copying them.
+    /// @p image must be aligned to at least `alignof(uint64_t)` - which MMap::span is - and outlive this SymPool.
+    /// New Sym%bols still go into this SymPool's own Arena.
+    /// This SymPool must be empty and must not have handed out any SymPool::ordinal yet - not even for a
+    /// Sym::pack%ed Sym%bol -, as the image's Sym%bols take the ordinals `0, ..., n-1`.
+    /// If @p image stems from a different build whose String::Hash disagrees with ours, its strings are interned
+    /// the normal way instead.
+    /// @returns `false` - and leaves this SymPool untouched - if @p image is malformed or the above does not hold.
+    bool load(std::span<const char8_t> image) {
+        assert(size() == 0 && "can only load into an empty SymPool");
+        auto data = (const char*)image.data();
+        if (size() != 0 || num_ordinals_ != 0 || !packed_ordinals_.empty() || image.size() < sizeof(Image::Header)
+            || uintptr_t(data) % alignof(uint64_t) != 0)
+            return false;
+
+        auto& header = *(const Image::Header*)data;
+        auto index   = (const uint64_t*)(data + sizeof(Image::Header));
+        if (header.magic != Image::Magic || header.size != image.size() || !std::has_single_bit(header.capacity)
+            || header.capacity > (image.size() - sizeof(Image::Header)) / sizeof(uint64_t))
+            return false;
+
+        // at least one empty slot - otherwise, Image::find would probe forever
+        if (header.num_strings >= header.capacity) return false;
+
+        // each record must lie within the image - '\0' included - and carry a distinct ordinal below num_strings
+        auto begin = sizeof(Image::Header) + header.capacity * sizeof(uint64_t);
+        std::vector<bool> ordinals(header.num_strings);
+        size_t num_strings = 0;
+        for (size_t i = 0; i != header.capacity; ++i) {
+            auto offset = index[i];
+            if (offset == 0) continue;
+            if (offset < begin || offset % Sym::Short_String_Bytes != 0 || offset >= image.size()
+                || image.size() - offset < sizeof(String))
+                return false;
+            auto str = (const String*)(data + offset);
+            if (image.size() - offset - sizeof(String) <= str->size || str->chars[str->size] != '\0'
+                || str->ordinal >= header.num_strings || ordinals[str->ordinal])
+                return false;
+            ordinals[str->ordinal] = true;
+            ++num_strings;
+        }
+        if (num_strings != header.num_strings) return false;
+
+        if (header.probe == Image::probe()) {
+            image_        = Image(data, index, header.capacity, header.num_strings);
+            num_ordinals_ = uint32_t(header.num_strings);
+        } else {
+            for (size_t i = 0; i != header.capacity; ++i)
+                if (auto offset = index[i]) sym(((const String*)(data + offset))->view());
+        }
+        return true;
+    }
     ///@}
 
+    /// Number of Sym%bols in this SymPool - excluding the ones that Sym::pack%s.
+    size_t size() const {
+        auto res = image_.size() + pool_.size();
+        for (auto& gen : epochs_) res += gen->pool.size();
+        return res;
+    }
+
+    /// @name Epochs
+    ///@{
+    /// For long-running processes like language servers, which would otherwise keep every identifier ever typed -
+    /// including the mistyped ones of intermediate edits.
+    /// While an Epoch is open, SymPool::sym puts *new* Strings into the Epoch's own Arena - instead of the *pinned*
+    /// generation, which holds everything interned outside of an Epoch, all of SymPool::load, and SymPool::pin.
+    /// Once no live AST references the Sym%bols of an Epoch anymore, SymPool::retire it;
+    /// its pages go back to a PagePool for later Epochs.
+    /// Use like this:
+    /// ```
+    /// for (auto keyword : keywords) driver.sym(keyword); // no Epoch open yet: pinned
+    /// auto epoch = driver.open_epoch();
+    /// auto ast   = parse(doc);
+    /// while (auto edit = next_edit()) {
+    ///     auto next = driver.open_epoch();
+    ///     ast       = parse(doc); // the old AST is gone ...
+    ///     driver.retire(std::exchange(epoch, next)); // ... and so are its Sym%bols
+    /// }
+    /// ```
+    /// Sym%bols keep their identity across Epochs: If SymPool::sym finds a String of an older Epoch, the current one
+    /// *borrows* it instead of making a copy.
+    /// Hence, an Epoch is only reclaimed once it is retired *and* all Epochs that borrow from it are reclaimed.
+    /// A String borrowed by the pinned generation pins its whole Epoch.
+    /// @note Each live Epoch costs one more hash probe for each Sym%bol that is not pinned.
+    /// @note SymPool::ordinal%s of reclaimed Strings are not reused.
+    using Epoch                             = uint32_t;
+    static constexpr Epoch Pinned           = 0;
+    static constexpr size_t Epoch_Page_Size = 64 * 1024;
+
+    /// Opens a new Epoch, which becomes the current SymPool::epoch.
+    Epoch open_epoch() {
+        if (!pages_) pages_ = std::make_unique<Arena::PagePool>(Epoch_Page_Size);
+        epochs_.emplace_back(std::make_unique<Generation>(next_epoch_, *pages_));
+        return epoch_ = next_epoch_++;
+    }
+
+    /// The Epoch new Strings go into - or SymPool::Pinned.
+    Epoch epoch() const { return epoch_; }
+
+    /// You promise that you don't use any Sym%bol anymore that SymPool::sym created while @p epoch was open.
+    /// If @p epoch is the current one, SymPool::Pinned becomes the current one again.
+    void retire(Epoch epoch) {
+        auto gen = find_epoch(epoch);
+        assert(gen != epochs_.end() && !(*gen)->retired && "unknown or already retired epoch");
+        (*gen)->retired = true;
+        if (epoch == epoch_) epoch_ = Pinned;
+        if (--(*gen)->refs == 0) reclaim(epoch);
+    }
+
+    /// Number of Epochs that are not reclaimed yet - including the retired ones that are still borrowed from.
+    size_t num_epochs() const { return epochs_.size(); }
+
+    /// Like SymPool::sym but puts a new String into the pinned generation - no matter which Epoch is open.
+    /// Use this for long-lived Sym%bols - keywords, the standard library - that you obtain while an Epoch is open.
+    Sym pin(std::string_view s) {
+        auto epoch = std::exchange(epoch_, Pinned);
+        auto res   = sym(s);
+        epoch_     = epoch;
+        return res;
+    }
+    ///@}
+
+    /// @name Ordinals
+    ///@{
+    /// Dense numbering `0, 1, 2, ...` of this SymPool's Sym%bols in order of request - for side tables like
+    /// SymVector and SymBitset that are mere arrays instead of hash maps.
+    /// A String-backed Sym%bol keeps its ordinal right in its String, so this is just a load.
+    /// Sym::pack%ed ones - including the empty Sym - get theirs on first request via a small map.
+    /// @p sym must stem from this SymPool.
+    uint32_t ordinal(Sym sym) {
+        if (sym.is_packed()) {
+            auto [i, ins] = packed_ordinals_.try_emplace(sym, num_ordinals_);
+            if (ins) ++num_ordinals_;
+            return i->second;
+        }
+        auto str = (const String*)sym.ptr_;
+        if (str->ordinal == String::No_Ordinal) str->ordinal = num_ordinals_++;
+        return str->ordinal;
+    }
+
+    /// Same as above but doesn't hand out a new ordinal.
+    /// @returns String::No_Ordinal, if @p sym does not have one yet.
+    uint32_t find_ordinal(Sym sym) const {
+        if (sym.is_packed()) {
+            auto i = packed_ordinals_.find(sym);
+            return i != packed_ordinals_.end() ? i->second : String::No_Ordinal;
+        }
+        return ((const String*)sym.ptr_)->ordinal;
+    }
+
+    uint32_t num_ordinals() const { return num_ordinals_; } ///< Number of handed out ordinals.
+    ///@}
+
+#ifdef FE_STATS
+    /// Only available with `FE_STATS` - see Driver::stats.
+    const Stats::Sym& stats() const { return stats_; }
+
+    /// Stats of all Arena%s of this SymPool - including the ones of the live Epoch%s.
+    /// These are not in Stats::global until the SymPool (or the Epoch) is gone.
+    Stats::Arena arena_stats() const {
+        auto res = strings_.stats();
+#ifndef FE_ABSL
+        res += container_.stats();
+#endif
+        for (const auto& gen : epochs_) {
+            res += gen->strings.stats();
+#ifndef FE_ABSL
+            res += gen->container.stats();
+#endif
+        }
+        return res;
+    }
+#endif
+
     friend void swap(SymPool& p1, SymPool& p2) noexcept {
         using std::swap;
         // clang-format off
-        swap(p1.strings_,   p2.strings_  );
+        swap(p1.strings_,         p2.strings_        );
 #ifndef FE_ABSL
-        swap(p1.container_, p2.container_);
+        swap(p1.container_,       p2.container_      );
+#endif
+        swap(p1.pool_,            p2.pool_           );
+        swap(p1.image_,           p2.image_          );
+        swap(p1.packed_ordinals_, p2.packed_ordinals_);
+        swap(p1.num_ordinals_,    p2.num_ordinals_   );
+        swap(p1.pages_,           p2.pages_          );
+        swap(p1.epochs_,          p2.epochs_         );
+        swap(p1.next_epoch_,      p2.next_epoch_     );
+        swap(p1.epoch_,           p2.epoch_          );
+#ifdef FE_STATS
+        swap(p1.stats_,           p2.stats_          );
 #endif
-        swap(p1.pool_,      p2.pool_     );
         // clang-format on
     }
 
 private:
-    Arena strings_;
+    /// Read-only view onto a SymPool::dump%ed image, that SymPool::sym probes before its own pool.
+    class Image {
+    public:
+        static constexpr uint64_t Magic        = 0x0073'6d79'732d'6566; // "fe-syms" in little endian
+        static constexpr size_t Min_Capacity   = 16;
+
+        struct Header {
+            uint64_t magic;
+            uint64_t probe; ///< String::Hash of a fixed string - to detect a different hash function.
+            uint64_t num_strings;
+            uint64_t capacity; ///< Of the index - a power of two.
+            uint64_t size;     ///< Of the whole image in bytes.
+        };
+
+        Image() noexcept = default;
+        Image(const char* data, const uint64_t* index, size_t capacity, size_t size)
+            : data_(data)
+            , index_(index)
+            , capacity_(capacity)
+            , size_(size) {}
+
+        static uint64_t probe() { return String::Hash()(std::string_view("fe::SymPool::Image")); }
+        static size_t record_size(const String* str) {
+            return (sizeof(String) + str->size + 1 + Sym::Short_String_Mask) & ~Sym::Short_String_Mask;
+        }
+
+        size_t size() const { return size_; }
+
+        const String* find(String::Key key) const {
+            if (capacity_ == 0) return nullptr;
+            for (auto i = key.hash & (capacity_ - 1);; i = (i + 1) & (capacity_ - 1)) {
+                auto offset = index_[i];
+                if (offset == 0) return nullptr;
+                auto str = (const String*)(data_ + offset);
+                if (String::Equal()(str, key)) return str;
+            }
+        }
+
+        /// Visits all Strings - in index order.
+        template<class F> void for_each(F f) const {
+            for (size_t i = 0; i != capacity_; ++i)
+                if (auto offset = index_[i]) f((const String*)(data_ + offset));
+        }
+
+        friend void swap(Image& i1, Image& i2) noexcept {
+            using std::swap;
+            // clang-format off
+            swap(i1.data_,     i2.data_    );
+            swap(i1.index_,    i2.index_   );
+            swap(i1.capacity_, i2.capacity_);
+            swap(i1.size_,     i2.size_    );
+            // clang-format on
+        }
+
+    private:
+        const char* data_      = nullptr;
+        const uint64_t* index_ = nullptr;
+        size_t capacity_       = 0;
+        size_t size_           = 0;
+    };
+
 #ifdef FE_ABSL
-    absl::flat_hash_set<const String*, absl::Hash<const String*>, String::Equal> pool_;
+    using Set = absl::flat_hash_set<const String*, String::Hash, String::Equal>;
 #else
+    using Set = std::unordered_set<const String*, String::Hash, String::Equal, Arena::Allocator<const String*>>;
+#endif
+
+    /// The Strings of one Epoch - together with the bookkeeping when to reclaim them.
+    struct Generation {
+        Generation(Epoch epoch, Arena::PagePool& pages)
+            : epoch(epoch)
+            , strings(pages)
+#ifndef FE_ABSL
+            , container(pages)
+            , pool(container.allocator<const String*>())
+#endif
+        {
+        }
+
+        Epoch epoch;
+        Arena strings;
+#ifndef FE_ABSL
+        Arena container;
+#endif
+        Set pool;
+        std::vector<Epoch> borrowed; ///< Older Epochs whose Strings this one uses.
+        uint32_t refs = 1;           ///< 1 until retired plus the number of Generations that borrow from this one.
+        bool retired  = false;
+        bool pinned   = false; ///< Borrowed by the pinned generation - i.e. never reclaimed.
+    };
+    using Epochs = std::vector<std::unique_ptr<Generation>>;
+
+    const String* insert(Arena& strings, Set& pool, String::Key key) {
+        auto ptr = String::mk(strings, key);
+        pool.emplace(ptr);
+#if defined(FE_STATS) && !defined(FE_ABSL)
+        if (pool.bucket_size(pool.bucket(ptr)) > 1) ++stats_.collisions;
+#endif
+        return ptr;
+    }
+
+    /// Looks up @p key in all live Epochs - oldest first - and lets the current generation borrow it.
+    const String* find_in_epochs(String::Key key) {
+        for (auto& gen : epochs_) {
+            if (auto i = gen->pool.find(key); i != gen->pool.end()) {
+                if (epoch_ == Pinned) {
+                    if (!gen->pinned) gen->pinned = true, ++gen->refs;
+                } else if (gen->epoch != epoch_) {
+                    auto& borrowed = epochs_.back()->borrowed;
+                    if (std::find(borrowed.begin(), borrowed.end(), gen->epoch) == borrowed.end())
+                        borrowed.emplace_back(gen->epoch), ++gen->refs;
+                }
+                return *i;
+            }
+        }
+        return nullptr;
+    }
+
+    /// Epochs only grow and are appended in order - so epochs_ is sorted.
+    Epochs::iterator find_epoch(Epoch epoch) {
+        auto i = std::lower_bound(epochs_.begin(), epochs_.end(), epoch,
+                                  [](const auto& gen, Epoch epoch) { return gen->epoch < epoch; });
+        return i != epochs_.end() && (*i)->epoch == epoch ? i : epochs_.end();
+    }
+
+    /// Frees the Generation of @p epoch, which nobody refers to anymore - and in turn the ones it borrowed from, if
+    /// they become unreferenced, too.
+    void reclaim(Epoch epoch) {
+        std::vector<Epoch> todo = {epoch};
+        while (!todo.empty()) {
+            auto gen = find_epoch(todo.back());
+            todo.pop_back();
+            for (auto borrowed : (*gen)->borrowed)
+                if (--(*find_epoch(borrowed))->refs == 0) todo.emplace_back(borrowed);
+            epochs_.erase(gen); // its pages go back to pages_
+        }
+    }
+
+    Arena strings_;
+#ifndef FE_ABSL
     Arena container_;
-    std::unordered_set<const String*, String::Hash, String::Equal, Arena::Allocator<const String*>> pool_;
 #endif
+    Set pool_;
+    Image image_;
+    SymMap<uint32_t> packed_ordinals_;
+    uint32_t num_ordinals_ = 0;
+    std::unique_ptr<Arena::PagePool> pages_; // must outlive epochs_
+    Epochs epochs_;
+    Epoch next_epoch_ = 1;
+    Epoch epoch_      = Pinned;
+#ifdef FE_STATS
+    Stats::Sym stats_;
+#endif
+};
+
+/// A side table that maps each Sym%bol of one SymPool to a @p V - as a plain array indexed by SymPool::ordinal.
+/// Compared to SymMap, a lookup is just an index operation instead of a hash probe.
+/// Use like this:
+/// ```
+/// fe::SymVector<Decl*> decls(driver.sym_pool());
+/// decls[sym] = decl;
+/// if (auto decl = decls.find(sym)) /*...*/;
+/// ```
+/// @note All Sym%bols that have an ordinal below the highest one in use occupy a slot - so make sure that the
+/// SymPool hands out ordinals only for Sym%bols you care about.
+template<class V, class A = std::allocator<V>> class SymVector {
+public:
+    /// @name Construction
+    ///@{
+    SymVector(SymPool& pool, const A& alloc = A())
+        : pool_(&pool)
+        , vec_(alloc) {}
+    ///@}
+
+    /// @name Access
+    ///@{
+    /// Default-constructs the slot for @p sym - and all slots below - if necessary.
+    V& operator[](Sym sym) {
+        auto i = pool_->ordinal(sym);
+        if (i >= vec_.size()) vec_.resize(pool_->num_ordinals());
+        return vec_[i];
+    }
+    /// @returns `nullptr`, if @p sym's slot does not exist (yet).
+    V* find(Sym sym) {
+        auto i = pool_->find_ordinal(sym);
+        return i < vec_.size() ? &vec_[i] : nullptr;
+    }
+    const V* find(Sym sym) const { return const_cast<SymVector*>(this)->find(sym); } ///< `const` version.
+    ///@}
+
+    /// @name Getters
+    ///@{
+    size_t size() const { return vec_.size(); } ///< Number of slots - not of assigned ones.
+    bool empty() const { return vec_.empty(); }
+    SymPool& pool() const { return *pool_; }
+    std::span<V> slots() { return vec_; } ///< Indexed by SymPool::ordinal.
+    std::span<const V> slots() const { return vec_; }
+    ///@}
+
+    void clear() { vec_.clear(); }
+
+    friend void swap(SymVector& v1, SymVector& v2) noexcept {
+        using std::swap;
+        // clang-format off
+        swap(v1.pool_, v2.pool_);
+        swap(v1.vec_,  v2.vec_ );
+        // clang-format on
+    }
+
+private:
+    SymPool* pool_;
+    std::vector<V, A> vec_;
+};
+
+/// A set of Sym%bols of one SymPool as a bit vector indexed by SymPool::ordinal.
+/// Use like this:
+/// ```
+/// fe::SymBitset keywords(driver.sym_pool());
+/// for (auto s : {"let", "fn", "if"}) keywords.set(driver.sym(s));
+/// if (keywords.test(sym)) /*...*/;
+/// ```
+class SymBitset {
+public:
+    /// @name Construction
+    ///@{
+    SymBitset(SymPool& pool)
+        : pool_(&pool) {}
+    ///@}
+
+    /// @name Access
+    ///@{
+    bool test(Sym sym) const {
+        auto i = pool_->find_ordinal(sym);
+        return i / 64 < words_.size() && (words_[i / 64] >> (i % 64)) & 1;
+    }
+    void set(Sym sym) {
+        auto i = pool_->ordinal(sym);
+        if (i / 64 >= words_.size()) words_.resize((pool_->num_ordinals() + 63) / 64);
+        words_[i / 64] |= uint64_t(1) << (i % 64);
+    }
+    void reset(Sym sym) {
+        auto i = pool_->find_ordinal(sym);
+        if (i / 64 < words_.size()) words_[i / 64] &= ~(uint64_t(1) << (i % 64));
+    }
+    /// Yields the previous state of @p sym's bit and sets it.
+    bool test_and_set(Sym sym) {
+        auto res = test(sym);
+        if (!res) set(sym);
+        return res;
+    }
+    ///@}
+
+    /// @name Getters
+    ///@{
+    /// Number of set bits.
+    size_t count() const {
+        size_t res = 0;
+        for (auto word : words_) res += std::popcount(word);
+        return res;
+    }
+    bool none() const { return std::ranges::all_of(words_, [](uint64_t word) { return word == 0; }); }
+    SymPool& pool() const { return *pool_; }
+    ///@}
+
+    void clear() { words_.clear(); }
+
+    friend void swap(SymBitset& b1, SymBitset& b2) noexcept {
+        using std::swap;
+        // clang-format off
+        swap(b1.pool_,  b2.pool_ );
+        swap(b1.words_, b2.words_);
+        // clang-format on
+    }
+
+private:
+    SymPool* pool_;
+    std::vector<uint64_t> words_;
+};
+
+/// Thread-safe counterpart of SymPool for lexing/parsing several files in parallel against one symbol table.
+/// Strings are distributed among ConcurrentSymPool::num_shards() *shards* by their hash.
+/// Each shard has its own Arena and its own open-addressing hash table, so Sym%bols from all threads remain
+/// pointer-comparable - just as with SymPool.
+/// Looking up an already interned string is lock-free; only inserting a new string locks its shard.
+class ConcurrentSymPool {
+public:
+    using String = Sym::String;
+
+    static constexpr size_t Default_Num_Shards = 32;
+
+    /// @name Constructor & Destruction
+    ///@{
+    /// @p num_shards will be rounded up to the next power of two.
+    ConcurrentSymPool(size_t num_shards = Default_Num_Shards)
+        : num_shards_(std::bit_ceil(std::max(num_shards, size_t(1))))
+        , shards_(std::make_unique<Shard[]>(num_shards_)) {}
+    ConcurrentSymPool(const ConcurrentSymPool&) = delete;
+    ConcurrentSymPool& operator=(ConcurrentSymPool) = delete;
+    ///@}
+
+    /// @name sym
+    ///@{
+    Sym sym(std::string_view s) {
+        if (s.empty()) return Sym();
+        if (Sym::is_short(s.size())) return Sym::pack(s);
+
+        auto key    = String::Key(s);
+        auto& shard = shards_[(key.hash >> (std::numeric_limits<size_t>::digits / 2)) & (num_shards_ - 1)];
+        if (auto str = shard.table.load(std::memory_order_acquire)->find(key)) return str;
+
+        auto lock  = std::lock_guard(shard.mutex);
+        auto table = shard.table.load(std::memory_order_relaxed);
+        if (auto str = table->find(key)) return str; // someone else was faster
+
+        if (2 * (shard.size + 1) > table->capacity) {
+            // Readers may still be probing the old table; it lives on in the shard's Arena.
+            auto old = table;
+            table    = Table::mk(shard.arena, 2 * old->capacity);
+            for (size_t i = 0; i != old->capacity; ++i)
+                if (auto str = old->slots[i].load(std::memory_order_relaxed)) table->insert(str);
+            shard.table.store(table, std::memory_order_release);
+        }
+
+        auto str = String::mk(shard.arena, key);
+        table->insert(str);
+        ++shard.size;
+        return str;
+    }
+    Sym sym(const std::string& s) { return sym((std::string_view)s); }
+    /// @p s is a null-terminated C-string.
+    Sym sym(const char* s) { return s == nullptr || *s == '\0' ? Sym() : sym(std::string_view(s, strlen(s))); }
+    /// See SymPool::sym_fold.
+    Sym sym_fold(std::string_view s) {
+        return utf8::fold(s, [this](std::string_view folded) { return sym(folded); });
+    }
+    ///@}
+
+    /// @name Getters
+    ///@{
+    size_t num_shards() const { return num_shards_; }
+    ///@}
+
+private:
+    struct Table {
+        static constexpr size_t Initial_Capacity = 16;
+
+        static Table* mk(Arena& arena, size_t capacity) {
+            auto slots = arena.allocate<std::atomic<const String*>>(capacity);
+            for (size_t i = 0; i != capacity; ++i) new (slots + i) std::atomic<const String*>(nullptr);
+            auto table = arena.allocate<Table>(1);
+            return new (table) Table{capacity, slots};
+        }
+
+        /// Lock-free lookup - safe while others Table::insert.
+        const String* find(String::Key key) const {
+            for (size_t i = key.hash & (capacity - 1);; i = (i + 1) & (capacity - 1)) {
+                auto str = slots[i].load(std::memory_order_acquire);
+                if (str == nullptr) return nullptr;
+                if (String::Equal()(str, key)) return str;
+            }
+        }
+
+        /// Only invoke while holding the Shard's lock.
+        void insert(const String* str) {
+            for (size_t i = str->hash & (capacity - 1);; i = (i + 1) & (capacity - 1)) {
+                if (slots[i].load(std::memory_order_relaxed) == nullptr) {
+                    slots[i].store(str, std::memory_order_release);
+                    return;
+                }
+            }
+        }
+
+        size_t capacity;
+        std::atomic<const String*>* slots;
+    };
+
+    struct alignas(64) Shard { // avoid false sharing among shards
+        Shard()
+            : table(Table::mk(arena, Table::Initial_Capacity)) {}
+
+        std::mutex mutex;
+        Arena arena{64 * 1024};
+        std::atomic<Table*> table;
+        size_t size = 0; ///< Number of Strings in Shard::table - guarded by Shard::mutex.
+    };
+
+    size_t num_shards_;
+    std::unique_ptr<Shard[]> shards_;
 };
 
 } // namespace fe
@@ -1,9 +1,19 @@
 #pragma once
 
-#include <cctype>
+#include <cstdint>
+#include <cstring>
 
+#include <array>
+#include <bit>
 #include <istream>
 #include <ostream>
+#include <string_view>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#    include <arm_neon.h>
+#endif
 
 #include "fe/assert.h"
 
@@ -58,24 +68,218 @@ inline char32_t decode(std::istream& is) {
     return result;
 }
 
-namespace {
-// and, or
-std::ostream& ao(std::ostream& os, char32_t c32, char32_t a = 0b00111111, char32_t o = 0b10000000) {
-    return os << char((c32 & a) | o);
+/// Decodes the next sequence of bytes in [@p ptr, @p end) as UTF-32 and advances @p ptr accordingly.
+/// ASCII only costs a single pointer bump.
+/// @returns Null on error and EoF, if @p ptr already reached @p end.
+inline char32_t decode(const char8_t*& ptr, const char8_t* end) {
+    if (ptr == end) return EoF;
+    char32_t result = *ptr++;
+    if (result < 0x80) return result;
+
+    switch (auto n = utf8::num_bytes(result)) {
+        case 0: return Null;
+        default:
+            result = utf8::first(result, n);
+
+            for (size_t i = 1; i != n; ++i)
+                if (auto x = ptr != end ? is_valid234(*ptr++) : char8_t(-1); x != char8_t(-1))
+                    result = utf8::append(result, x);
+                else
+                    return Null;
+    }
+
+    return result;
+}
+
+/// Encodes the UTF-32 char @p c32 as UTF-8 and writes the sequence of bytes to @p out.
+/// @p out must have room for at least utf8::Max bytes.
+/// @returns the position right behind the written sequence or `nullptr` on error.
+inline char8_t* encode(char8_t* out, char32_t c32) {
+    auto cont = [](char32_t c) { return char8_t(0b10000000 | (c & 0b00111111)); };
+    if (c32 <= 0x00007f) {
+        *out++ = char8_t(c32);
+    } else if (c32 <= 0x0007ff) {
+        *out++ = char8_t(0b11000000 | (c32 >> 6));
+        *out++ = cont(c32);
+    } else if (c32 <= 0x00ffff) {
+        *out++ = char8_t(0b11100000 | (c32 >> 12));
+        *out++ = cont(c32 >> 6);
+        *out++ = cont(c32);
+    } else if (c32 <= 0x10ffff) {
+        *out++ = char8_t(0b11110000 | (c32 >> 18));
+        *out++ = cont(c32 >> 12);
+        *out++ = cont(c32 >> 6);
+        *out++ = cont(c32);
+    } else {
+        return nullptr;
+    }
+    return out;
+}
+
+/// Encodes all of @p str as UTF-8 into @p out which must have room for at least `utf8::Max * str.size()` bytes.
+/// @returns the position right behind the written sequence or `nullptr` on error.
+inline char8_t* encode(char8_t* out, std::u32string_view str) {
+    for (auto c32 : str) {
+        if (c32 <= 0x7f)
+            *out++ = char8_t(c32);
+        else if (out = encode(out, c32); out == nullptr)
+            return nullptr;
+    }
+    return out;
 }
-} // namespace
 
 /// Encodes the UTF-32 char @p c32 as UTF-8 and writes the sequence of bytes to @p os.
 /// @returns `false` on error.
 inline bool encode(std::ostream& os, char32_t c32) {
-    // clang-format off
-    if (c32 <= 0x00007f) {          ao(os, c32      , 0b11111111, 0b00000000);                              return true; }
-    if (c32 <= 0x0007ff) {       ao(ao(os, c32 >>  6, 0b00011111, 0b11000000),                        c32); return true; }
-    if (c32 <= 0x00ffff) {    ao(ao(ao(os, c32 >> 12, 0b00001111, 0b11100000),             c32 >> 6), c32); return true; }
-    if (c32 <= 0x10ffff) { ao(ao(ao(ao(os, c32 >> 18, 0b00000111, 0b11110000), c32 >> 12), c32 >> 6), c32); return true; }
-    // clang-format on
+    char8_t buf[Max];
+    if (auto end = encode(buf, c32)) {
+        os.write((const char*)buf, end - buf);
+        return true;
+    }
     return false;
 }
+
+/// @name Bulk Operations
+///@{
+/// These work on a whole buffer at once and use SSE2/AVX2 or NEON - if available - with a scalar fallback.
+
+/// @returns the first non-ASCII byte in [@p begin, @p end) or @p end, if there is none.
+inline const char8_t* skip_ascii(const char8_t* begin, const char8_t* end) {
+    auto p = begin;
+#if defined(__AVX2__)
+    for (; end - p >= 32; p += 32) {
+        auto v = _mm256_loadu_si256((const __m256i*)p);
+        if (auto mask = unsigned(_mm256_movemask_epi8(v))) return p + std::countr_zero(mask);
+    }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    for (; end - p >= 16; p += 16) {
+        auto v = _mm_loadu_si128((const __m128i*)p);
+        if (auto mask = unsigned(_mm_movemask_epi8(v))) return p + std::countr_zero(mask);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; end - p >= 16; p += 16) {
+        if (vmaxvq_u8(vld1q_u8((const uint8_t*)p)) & 0x80) break; // find exact position below
+    }
+#endif
+    for (; end - p >= 8; p += 8) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        if (auto mask = word & UINT64_C(0x8080808080808080)) {
+            if constexpr (std::endian::native == std::endian::little)
+                return p + std::countr_zero(mask) / 8;
+            else
+                return p + std::countl_zero(mask) / 8;
+        }
+    }
+    for (; p != end; ++p)
+        if (*p & 0x80) return p;
+    return end;
+}
+
+/// Validates [@p begin, @p end) as UTF-8.
+/// In contrast to utf8::decode, this also rejects overlong encodings, surrogates, and code points beyond `0x10ffff`.
+/// ASCII runs are skipped via utf8::skip_ascii; only multi-byte sequences are checked one by one.
+/// @returns the begin of the first invalid sequence or @p end, if everything is fine.
+inline const char8_t* validate(const char8_t* begin, const char8_t* end) {
+    for (auto p = begin;;) {
+        if (p = skip_ascii(p, end); p == end) return end;
+
+        auto n = num_bytes(*p);
+        if (n == 0 || size_t(end - p) < n) return p;
+
+        char32_t c = first(*p, n);
+        for (size_t i = 1; i != n; ++i)
+            if (auto x = is_valid234(p[i]); x != char8_t(-1))
+                c = append(c, x);
+            else
+                return p;
+
+        static constexpr char32_t Min[] = {0, 0, 0x80, 0x800, 0x10000};
+        if (c < Min[n] || c > 0x10ffff || (0xd800 <= c && c <= 0xdfff)) return p;
+        p += n;
+    }
+}
+
+/// Is all of @p str valid UTF-8?
+inline bool is_valid(std::u8string_view str) {
+    auto end = str.data() + str.size();
+    return validate(str.data(), end) == end;
+}
+
+/// Invokes @p f with a pointer to each occurrence of the byte @p c in [@p begin, @p end) - in order.
+template<class F> void scan(const char8_t* begin, const char8_t* end, char8_t c, F f) {
+    auto p = begin;
+#if defined(__AVX2__)
+    for (auto v = _mm256_set1_epi8(char(c)); end - p >= 32; p += 32) {
+        auto mask = unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)p), v)));
+        for (; mask; mask &= mask - 1) f(p + std::countr_zero(mask));
+    }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    for (auto v = _mm_set1_epi8(char(c)); end - p >= 16; p += 16) {
+        auto mask = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), v)));
+        for (; mask; mask &= mask - 1) f(p + std::countr_zero(mask));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (auto v = vdupq_n_u8(c); end - p >= 16; p += 16) {
+        if (vmaxvq_u8(vceqq_u8(vld1q_u8((const uint8_t*)p), v)) == 0) continue;
+        for (size_t i = 0; i != 16; ++i)
+            if (p[i] == c) f(p + i);
+    }
+#endif
+    for (; p != end; ++p)
+        if (*p == c) f(p);
+}
+
+/// Copies [@p begin, @p end) to @p out while lowering `A`-`Z`; all other bytes - including those of multi-byte
+/// sequences - stay as they are. @p out may be @p begin.
+/// @returns the position right behind the written bytes.
+inline char8_t* lower_ascii(const char8_t* begin, const char8_t* end, char8_t* out) {
+    auto p = begin;
+#if defined(__AVX2__)
+    for (auto a = _mm256_set1_epi8('A' - 1), z = _mm256_set1_epi8('Z' + 1), bit = _mm256_set1_epi8(0x20);
+         end - p >= 32; p += 32, out += 32) {
+        auto v     = _mm256_loadu_si256((const __m256i*)p); // bytes >= 0x80 are negative and thus no upper
+        auto upper = _mm256_and_si256(_mm256_cmpgt_epi8(v, a), _mm256_cmpgt_epi8(z, v));
+        _mm256_storeu_si256((__m256i*)out, _mm256_or_si256(v, _mm256_and_si256(upper, bit)));
+    }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    for (auto a = _mm_set1_epi8('A' - 1), z = _mm_set1_epi8('Z' + 1), bit = _mm_set1_epi8(0x20); end - p >= 16;
+         p += 16, out += 16) {
+        auto v     = _mm_loadu_si128((const __m128i*)p);
+        auto upper = _mm_and_si128(_mm_cmpgt_epi8(v, a), _mm_cmpgt_epi8(z, v));
+        _mm_storeu_si128((__m128i*)out, _mm_or_si128(v, _mm_and_si128(upper, bit)));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (auto a = vdupq_n_u8('A'), n = vdupq_n_u8(26), bit = vdupq_n_u8(0x20); end - p >= 16; p += 16, out += 16) {
+        auto v = vld1q_u8((const uint8_t*)p);
+        vst1q_u8((uint8_t*)out, vorrq_u8(v, vandq_u8(vcltq_u8(vsubq_u8(v, a), n), bit)));
+    }
+#endif
+    // SWAR: a byte is upper if it is ASCII and adding these offsets to its low 7 bits carries for 'A' but not 'Z'
+    static constexpr uint64_t Ones = UINT64_C(0x0101010101010101);
+    for (; end - p >= 8; p += 8, out += 8) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        auto low   = word & (0x7f * Ones);
+        auto upper = (low + (0x80 - 'A') * Ones) ^ (low + (0x7f - 'Z') * Ones);
+        word |= (upper & ~word & (0x80 * Ones)) >> 2;
+        std::memcpy(out, &word, 8);
+    }
+    for (; p != end; ++p) *out++ = char8_t(*p + ((unsigned(*p - 'A') < 26) << 5));
+    return out;
+}
+
+/// Number of code points in [@p begin, @p end) - i.e. all bytes that are no continuation bytes.
+inline size_t num_chars(const char8_t* begin, const char8_t* end) {
+    size_t n = 0;
+    for (auto p = begin; p != end; ++p) n += (*p & 0b11000000) != 0b10000000;
+    return n;
+}
+///@}
+
 /// Wrapper for `char32_t` which has a friend ostream operator.
 struct Char32 {
     Char32(char32_t c)
@@ -92,25 +296,72 @@ struct Char32 {
 
 /// @name Wrappers
 ///@{
-/// Safe `char32_t`-style wrappers for <[ctype](https://en.cppreference.com/w/cpp/header/cctype)> functions:
-/// > Like all other functions from `<cctype>`, the behavior of `std::isalnum` is undefined if the argument's value is
-/// neither representable as `unsigned char` nor equal to `EOF`.
+/// Locale-independent `char32_t`-style replacements for <[ctype](https://en.cppreference.com/w/cpp/header/cctype)>
+/// functions.
+/// They behave like their `<cctype>` counterparts in the `"C"` locale, but are a mere table lookup and are safe to
+/// call with *any* `char32_t` - everything beyond ASCII is simply `false`.
+/// Use fe::utf8::isxidstart/fe::utf8::isxidcontinue from fe/xid.h for Unicode identifiers and fe::utf8::fold from
+/// fe/fold.h for Unicode case folding.
+namespace ctype {
+enum : uint16_t {
+    Cntrl = 1 << 0,
+    Print = 1 << 1,
+    Space = 1 << 2,
+    Blank = 1 << 3,
+    Punct = 1 << 4,
+    Digit = 1 << 5,
+    XDigit = 1 << 6,
+    Lower = 1 << 7,
+    Upper = 1 << 8,
+    Alpha = Lower | Upper,
+    Alnum = Alpha | Digit,
+    Graph = Alnum | Punct,
+};
+
+inline constexpr auto Table = [] {
+    std::array<uint16_t, 256> t{};
+    for (char32_t c = 0; c != 0x80; ++c) {
+        auto& f = t[c];
+        if (c < 0x20 || c == 0x7f) f |= Cntrl;
+        if (0x20 <= c && c < 0x7f) f |= Print;
+        if (c == ' ' || ('\t' <= c && c <= '\r')) f |= Space;
+        if (c == ' ' || c == '\t') f |= Blank;
+        if ('0' <= c && c <= '9') f |= Digit | XDigit;
+        if (('a' <= c && c <= 'f') || ('A' <= c && c <= 'F')) f |= XDigit;
+        if ('a' <= c && c <= 'z') f |= Lower;
+        if ('A' <= c && c <= 'Z') f |= Upper;
+        if ((f & Print) && c != ' ' && !(f & Alnum)) f |= Punct;
+    }
+    return t;
+}();
+
+constexpr bool is(char32_t c, uint16_t mask) { return c <= 0xff && (Table[c] & mask); }
+} // namespace ctype
+
 // clang-format off
-inline bool isalnum (char32_t c) { return (c & ~0xFF) == 0 ? std::isalnum (c) : false; }
-inline bool isalpha (char32_t c) { return (c & ~0xFF) == 0 ? std::isalpha (c) : false; }
-inline bool isblank (char32_t c) { return (c & ~0xFF) == 0 ? std::isblank (c) : false; }
-inline bool iscntrl (char32_t c) { return (c & ~0xFF) == 0 ? std::iscntrl (c) : false; }
-inline bool isdigit (char32_t c) { return (c & ~0xFF) == 0 ? std::isdigit (c) : false; }
-inline bool isgraph (char32_t c) { return (c & ~0xFF) == 0 ? std::isgraph (c) : false; }
-inline bool islower (char32_t c) { return (c & ~0xFF) == 0 ? std::islower (c) : false; }
-inline bool isprint (char32_t c) { return (c & ~0xFF) == 0 ? std::isprint (c) : false; }
-inline bool ispunct (char32_t c) { return (c & ~0xFF) == 0 ? std::ispunct (c) : false; }
-inline bool isspace (char32_t c) { return (c & ~0xFF) == 0 ? std::isspace (c) : false; }
-inline bool isupper (char32_t c) { return (c & ~0xFF) == 0 ? std::isupper (c) : false; }
-inline bool isxdigit(char32_t c) { return (c & ~0xFF) == 0 ? std::isxdigit(c) : false; }
-inline bool isascii (char32_t c) { return c <= 0x7F; }
-inline char32_t tolower(char32_t c) { return (c & ~0xFF) == 0 ? std::tolower(c) : c; }
-inline char32_t toupper(char32_t c) { return (c & ~0xFF) == 0 ? std::toupper(c) : c; }
+constexpr bool isalnum (char32_t c) { return ctype::is(c, ctype::Alnum ); }
+constexpr bool isalpha (char32_t c) { return ctype::is(c, ctype::Alpha ); }
+constexpr bool isblank (char32_t c) { return ctype::is(c, ctype::Blank ); }
+constexpr bool iscntrl (char32_t c) { return ctype::is(c, ctype::Cntrl ); }
+constexpr bool isdigit (char32_t c) { return ctype::is(c, ctype::Digit ); }
+constexpr bool isgraph (char32_t c) { return ctype::is(c, ctype::Graph ); }
+constexpr bool islower (char32_t c) { return ctype::is(c, ctype::Lower ); }
+constexpr bool isprint (char32_t c) { return ctype::is(c, ctype::Print ); }
+constexpr bool ispunct (char32_t c) { return ctype::is(c, ctype::Punct ); }
+constexpr bool isspace (char32_t c) { return ctype::is(c, ctype::Space ); }
+constexpr bool isupper (char32_t c) { return ctype::is(c, ctype::Upper ); }
+constexpr bool isxdigit(char32_t c) { return ctype::is(c, ctype::XDigit); }
+constexpr bool isascii (char32_t c) { return c <= 0x7F; }
+constexpr char32_t tolower(char32_t c) { return c + (char32_t(isupper(c)) << 5); } // branchless
+constexpr char32_t toupper(char32_t c) { return c - (char32_t(islower(c)) << 5); } // branchless
+
+/// Unicode [White_Space](https://www.unicode.org/Public/UCD/latest/ucd/PropList.txt) - unlike fe::utf8::isspace this
+/// also includes e.g. U+0085 NEXT LINE, U+00A0 NO-BREAK SPACE, and U+2028 LINE SEPARATOR.
+constexpr bool isuspace(char32_t c) {
+    if (c <= 0x7f) return isspace(c);
+    return c == 0x85 || c == 0xa0 || c == 0x1680 || (0x2000 <= c && c <= 0x200a) || c == 0x2028 || c == 0x2029
+        || c == 0x202f || c == 0x205f || c == 0x3000;
+}
 
 /// Is @p c within [begin, finis]?
 inline bool isrange(char32_t c, char32_t begin, char32_t finis) { return begin <= c && c <= finis; }
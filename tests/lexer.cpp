@@ -1,184 +1,672 @@
 #include <sstream>
 
 #include <doctest/doctest.h>
-#include <fe/driver.h>
-#include <fe/lexer.h>
+#include <fe/feed.h>
 #include <fe/loc.cpp.h>
 #include <fe/parser.h>
+#include <fe/relex.h>
+#include <fe/source.h>
+#include <fe/split.h>
+#include <fe/stream.h>
 
-using fe::Loc;
-using fe::Pos;
-using fe::Sym;
+#include "lexer.h"
 
-namespace utf8 = fe::utf8;
+class Parser : public fe::Parser<Tok, Tok::Tag, 1, Parser> {};
+
+template<size_t K, class... Args> void test_lexer(Args&&... args) {
+    fe::Driver drv;
+    Lexer<K> lexer(drv, std::forward<Args>(args)...);
+
+    auto t1 = lexer.lex();
+    auto t2 = lexer.lex();
+    auto t3 = lexer.lex();
+    auto t4 = lexer.lex();
+    auto t5 = lexer.lex();
+    auto t6 = lexer.lex();
+    auto t7 = lexer.lex();
+    auto t8 = lexer.lex();
+    auto t9 = lexer.lex();
+    auto s  = std::format("{} {} {} {} {} {} {} {} {}", t1, t2, t3, t4, t5, t6, t7, t8, t9);
+    CHECK(s == "test abc def if while λ foo <end of file> <end of file>");
+
+    // clang-format off
+    CHECK(t1.loc() == Loc({1,  2}, {1,  5}));
+    CHECK(t2.loc() == Loc({1,  8}, {1, 10}));
+    CHECK(t3.loc() == Loc({1, 15}, {1, 17}));
+    CHECK(t4.loc() == Loc({1, 19}, {1, 20}));
+    CHECK(t5.loc() == Loc({2,  1}, {2,  5}));
+    CHECK(t6.loc() == Loc({2,  7}, {2,  7}));
+    CHECK(t7.loc() == Loc({2,  9}, {2, 11}));
+    CHECK(t8.loc() == Loc({2, 14}, {2, 14}));
+    CHECK(t9.loc() == Loc({2, 14}, {2, 14}));
+    // clang-format on
+}
 
-#define LET_KEY(m) m(K_let, "let") m(K_return, "return")
+static constexpr std::u8string_view Input = u8" test  abc    def if  \nwhile λ foo   ";
+
+template<size_t K> void test_lexer() {
+    std::istringstream is(std::string((const char*)Input.data(), Input.size()));
+    test_lexer<K>(is);
+    test_lexer<K>(std::span<const char8_t>(Input));
+}
+
+TEST_CASE("Lexer") {
+    test_lexer<1>();
+    test_lexer<2>();
+    test_lexer<3>();
+}
 
-#define LET_MISC(m) m(M_id, "<identifier>") m(M_lit, "<literal>")
+TEST_CASE("Lexer - keywords") {
+    static_assert(Keywords.find("let")->tag == Tok::Tag::K_let);
+    static_assert(Keywords.find("return")->tag == Tok::Tag::K_return);
+    static_assert(Keywords.find("lett") == nullptr);
+    static_assert(Keywords.find("") == nullptr);
+
+    static constexpr auto Many = fe::mk_keywords<int>({
+        {"alignas", 0}, {"alignof", 1}, {"and", 2}, {"asm", 3}, {"auto", 4}, {"bool", 5}, {"break", 6},
+        {"case", 7}, {"catch", 8}, {"char", 9}, {"class", 10}, {"const", 11}, {"constexpr", 12},
+        {"continue", 13}, {"decltype", 14}, {"default", 15}, {"delete", 16}, {"do", 17}, {"double", 18},
+        {"else", 19}, {"enum", 20}, {"explicit", 21}, {"extern", 22}, {"false", 23}, {"float", 24},
+        {"for", 25}, {"friend", 26}, {"goto", 27}, {"if", 28}, {"inline", 29}, {"int", 30}, {"long", 31},
+    });
+    for (auto& keyword : Many) {
+        CHECK(Many.find(keyword.str) == &keyword);
+        CHECK(Many.index(Many.find(keyword.str)) == size_t(keyword.tag));
+    }
+    CHECK(Many.find("while") == nullptr);
 
-#define LET_TOK(m) m(D_paren_l, "(") m(D_paren_r, ")") m(T_semicolon, ";") m(T_lambda, "λ") m(T_EoF, "<end of file>")
+    fe::Driver drv;
+    std::istringstream is("let x return");
+    Lexer lexer(drv, is);
+    CHECK(lexer.lex().tag() == Tok::Tag::K_let);
+    CHECK(lexer.lex().tag() == Tok::Tag::M_id);
+    CHECK(lexer.lex().tag() == Tok::Tag::K_return);
 
-#define LET_OP(m)                                                                                       \
-    m(O_add, "+", Add, true) m(O_sub, "-", Add, true) m(O_mul, "*", Mul, true) m(O_div, "/", Mul, true) \
-        m(O_ass, "=", ASS, false)
+    auto syms = Keywords.intern(drv);
+    CHECK(syms[Keywords.index(Keywords.find("return"))] == drv.sym("return"));
+}
 
-class Tok {
+enum class P { lt, shl, shl_ass, sub, arrow, colon, colon_colon, dot, ellipsis, lambda, err };
+
+static constexpr auto Punct_Table = fe::mk_punctuators<P>({
+    {"<", P::lt},
+    {"<<", P::shl},
+    {"<<=", P::shl_ass},
+    {"-", P::sub},
+    {"->", P::arrow},
+    {":", P::colon},
+    {"::", P::colon_colon},
+    {".", P::dot},
+    {"...", P::ellipsis}, // ".." is no spelling
+    {"λ", P::lambda},
+});
+
+template<size_t K> class PunctLexer : public fe::Lexer<K, PunctLexer<K>> {
 public:
-    enum Tag {
-#define CODE(t, str) t,
-        LET_KEY(CODE) LET_MISC(CODE) LET_TOK(CODE)
-#undef CODE
-#define CODE(t, str, prec, left_assoc) t,
-            LET_OP(CODE)
-#undef CODE
-    };
+    PunctLexer(std::u8string_view s)
+        : fe::Lexer<K, PunctLexer<K>>(std::span<const char8_t>(s)) {}
 
-    enum Prec { Err, Bot, Ass, Add, Mul };
-
-    Tok() {}
-    Tok(Loc loc, Tag tag)
-        : loc_(loc)
-        , tag_(tag) {}
-    Tok(Loc loc, Sym sym)
-        : loc_(loc)
-        , tag_(Tag::M_id)
-        , sym_(sym) {}
-    Tok(Loc loc, uint64_t u64)
-        : loc_(loc)
-        , tag_(Tag::M_lit)
-        , u64_(u64) {}
-
-    Tag tag() const { return tag_; }
-    Loc loc() const { return loc_; }
-
-    static const char* tag2str(Tag tag) {
-        switch (tag) {
-#define CODE(t, str) \
-    case Tok::Tag::t: return str;
-            LET_KEY(CODE)
-            LET_TOK(CODE)
-            LET_MISC(CODE)
-#undef CODE
-#define CODE(t, str, prec, left_assoc) \
-    case Tok::Tag::t: return str;
-            LET_OP(CODE)
-#undef CODE
-            default: fe::unreachable();
+    std::vector<P> lex() {
+        std::vector<P> res;
+        while (true) {
+            this->start();
+            if (this->accept(utf8::EoF)) return res;
+            if (this->accept(utf8::isspace)) continue;
+            if (auto punct = this->accept_longest(Punct_Table))
+                res.emplace_back(punct->tag);
+            else
+                res.emplace_back(P::err), this->next();
         }
     }
+};
+
+TEST_CASE("Lexer - punctuators") {
+    static_assert(Punct_Table.find("<<=")->tag == P::shl_ass);
+    static_assert(Punct_Table.find("λ")->tag == P::lambda);
+    static_assert(Punct_Table.find("..") == nullptr);
+    static_assert(Punct_Table.find("<<<") == nullptr);
+    static_assert(Punct_Table.lookahead() == 2); // due to ".."
+    static_assert(Punct_Table.num_states() == 12);
+
+    auto in = std::u8string_view(u8"<<= << < ->- :::λλ. .. ... <<<=x"); // "<=" is no spelling either
+    // clang-format off
+    CHECK(PunctLexer<2>(in).lex() == std::vector<P>{P::shl_ass, P::shl, P::lt, P::arrow, P::sub, P::colon_colon, P::colon,
+        P::lambda, P::lambda, P::dot, P::dot, P::dot, P::ellipsis, P::shl, P::lt, P::err, P::err});
+    // K == 1 doesn't see "..." coming
+    CHECK(PunctLexer<1>(in).lex() == std::vector<P>{P::shl_ass, P::shl, P::lt, P::arrow, P::sub, P::colon_colon, P::colon,
+        P::lambda, P::lambda, P::dot, P::dot, P::dot, P::dot, P::dot, P::dot, P::shl, P::lt, P::err, P::err});
+    // clang-format on
+}
+
+TEST_CASE("Lexer - buffer") {
+    fe::Driver drv;
+    std::u8string_view input = u8"\ufeffλ\xff(";
+    Lexer lexer(drv, std::span<const char8_t>(input));
+    CHECK(lexer.lex().tag() == Tok::Tag::T_lambda);
+    CHECK(lexer.lex().tag() == Tok::Tag::D_paren_l); // invalid UTF-8 sequence is skipped
+    CHECK(lexer.lex().tag() == Tok::Tag::T_EoF);
+}
+
+class Spelling : public fe::Lexer<1, Spelling> {
+public:
+    Spelling(std::span<const char8_t> buffer)
+        : fe::Lexer<1, Spelling>(buffer) {}
 
-    std::string to_string() const {
-        if (tag_ == M_id) return sym_.str();
-        if (tag_ == M_lit) return std::to_string(u64_);
-        return tag2str(tag_);
+    std::string_view id() {
+        start();
+        while (accept(utf8::isalpha)) {}
+        return str();
     }
 
-    friend std::ostream& operator<<(std::ostream& os, Tok tok) { return os << tok.to_string(); }
+    std::string_view lower() {
+        start();
+        while (accept<Append::Lower>(utf8::isalpha)) {}
+        return str();
+    }
 
-private:
-    Loc loc_;
-    Tag tag_;
-    union {
-        Sym sym_;
-        uint64_t u64_;
-    };
+    std::string_view quoted() {
+        start();
+        accept<Append::Off>('"');
+        while (true) {
+            if (accept<Append::Off>('"')) return str();
+            if (accept<Append::Off>('\\')) {
+                if (accept<Append::Off>('n')) append('\n');
+            } else {
+                accept(utf8::isprint);
+            }
+        }
+    }
+
+    void skip() { accept<Append::Off>(' '); }
 };
 
-template<> struct std::formatter<Tok> : fe::ostream_formatter {};
+TEST_CASE("Lexer - spelling") {
+    std::u8string_view input = u8"abc abc ABC aBc \"ab\" \"a\\nb\"";
+    auto begin               = (const char*)input.data();
+    auto end                 = begin + input.size();
+    Spelling lexer({input.data(), input.size()});
+
+    auto s1 = lexer.id();
+    CHECK(s1 == "abc");
+    CHECK(begin <= s1.data());
+    CHECK(s1.data() < end); // zero-copy
+    lexer.skip();
+
+    auto s2 = lexer.lower();
+    CHECK(s2 == "abc");
+    CHECK(begin <= s2.data());
+    CHECK(s2.data() < end); // already lower case: still zero-copy
+    lexer.skip();
+
+    CHECK(lexer.lower() == "abc");
+    lexer.skip();
+    CHECK(lexer.lower() == "abc");
+    lexer.skip();
+
+    auto s3 = lexer.quoted();
+    CHECK(s3 == "ab");
+    CHECK(begin <= s3.data());
+    CHECK(s3.data() < end);
+    lexer.skip();
+
+    CHECK(lexer.quoted() == "a\nb");
+}
 
-template<size_t K = 1> class Lexer : public fe::Lexer<K, Lexer<K>> {
+class Offsets : public fe::Lexer<2, Offsets> {
 public:
-    using fe::Lexer<K, Lexer<K>>::ahead;
-    using fe::Lexer<K, Lexer<K>>::accept;
-    using fe::Lexer<K, Lexer<K>>::next;
+    static constexpr bool Track_Pos = false;
 
-    using fe::Lexer<K, Lexer<K>>::loc_;
-    using fe::Lexer<K, Lexer<K>>::peek_;
-    using fe::Lexer<K, Lexer<K>>::str_;
+    Offsets(const fe::SourceManager::File* file)
+        : fe::Lexer<2, Offsets>(file->span())
+        , file_(file) {}
 
-    Lexer(fe::Driver& driver, std::istream& istream, const std::filesystem::path* path = nullptr)
-        : fe::Lexer<K, Lexer<K>>(istream, path)
-        , driver_(driver) {}
+    fe::SLoc id() {
+        while (accept<Append::Off>(' ')) {}
+        auto begin = offset();
+        while (accept(utf8::isalpha)) {}
+        return file_->sloc(begin, offset());
+    }
 
-    Tok lex() {
-        while (true) {
-            this->start();
+    Pos peek() const { return peek_; }
 
-            if (accept(utf8::Null)) {
-                std::cerr << "invalid UTF-8 sequence" << std::endl;
-                continue;
-            }
+private:
+    const fe::SourceManager::File* file_;
+};
 
-            if (accept(utf8::EoF)) return {loc_, Tok::Tag::T_EoF};
-            if (accept(utf8::isspace)) continue;
+TEST_CASE("Lexer - offsets") {
+    fe::SourceManager sm;
+    Offsets lexer(sm.add("offsets", u8"\ufeffab  cde\n  f"));
+    CHECK(sm.str(lexer.id()) == "offsets:1:2-3"); // the BOM is a code point in its own right
+    CHECK(sm.str(lexer.id()) == "offsets:1:6-8");
+    CHECK(lexer.id() == fe::SLoc(1 + 10)); // stops at '\n'
+    CHECK(lexer.peek() == Pos(1, 1)); // no row/col bookkeeping
+}
 
-            if (accept('(')) return {loc_, Tok::Tag::D_paren_l};
-            if (accept('(')) return {loc_, Tok::Tag::D_paren_r};
+template<size_t K> void test_feed(std::string_view text, size_t chunk_size) {
+    auto eof = [](const Tok& tok) { return tok.tag() == Tok::Tag::T_EoF; };
+    fe::Driver drv;
 
-            if (accept('+')) return {loc_, Tok::Tag::O_add};
-            if (accept('-')) return {loc_, Tok::Tag::O_sub};
-            if (accept('*')) return {loc_, Tok::Tag::O_mul};
-            if (accept('/')) return {loc_, Tok::Tag::O_div};
-            if (accept('=')) return {loc_, Tok::Tag::O_ass};
+    std::vector<std::string> expected;
+    Lexer<K> full(drv, std::span((const char8_t*)text.data(), text.size()));
+    while (true) {
+        auto tok = full.lex();
+        expected.emplace_back(std::format("{} {}", tok.to_string(), tok.loc()));
+        if (eof(tok)) break;
+    }
 
-            if (accept(';')) return {loc_, Tok::Tag::T_semicolon};
+    std::vector<std::string> got;
+    fe::Feed<Lexer<K>> feed(eof, [&](std::span<const char8_t> buffer) { return Lexer<K>(drv, buffer); });
+    auto drain = [&] {
+        while (auto tok = feed.next()) got.emplace_back(std::format("{} {}", tok->to_string(), tok->loc()));
+    };
+    for (size_t i = 0; i < text.size(); i += chunk_size) {
+        feed.push(text.substr(i, chunk_size));
+        drain();
+    }
+    CHECK(!feed.done());
+    feed.close();
+    drain();
+    CHECK(feed.done());
+    CHECK(feed.pending() == 0);
+    CHECK(got == expected);
+}
 
-            if (accept(U'λ')) return {loc_, Tok::Tag::T_lambda};
+TEST_CASE("Lexer - feed") {
+    // the λs are split across chunks for most chunk sizes
+    auto text = std::string_view("let λx = a + 23 * bcd;\n\tλ  foo.bar (x) 1234567");
+    for (size_t chunk_size = 1; chunk_size != 8; ++chunk_size) {
+        test_feed<1>(text, chunk_size);
+        test_feed<2>(text, chunk_size);
+        test_feed<3>(text, chunk_size);
+    }
 
-            if (accept([](char32_t c) { return c == '_' || utf8::isalpha(c); })) {
-                while (accept([](char32_t c) { return c == '_' || c == '.' || utf8::isalnum(c); })) {}
-                return {loc_, driver_.sym(str_)};
-            }
+    // consumed input is dropped from time to time
+    std::string many;
+    for (int i = 0; i != 10000; ++i) many += std::format("x{} = {};\n", i, i);
+    auto eof = [](const Tok& tok) { return tok.tag() == Tok::Tag::T_EoF; };
+    fe::Driver drv;
+    fe::Feed<Lexer<1>> feed(eof, [&](std::span<const char8_t> buffer) { return Lexer<1>(drv, buffer); });
+    size_t num = 0;
+    for (size_t i = 0; i < many.size(); i += 1000) {
+        feed.push(std::string_view(many).substr(i, 1000));
+        while (feed.next()) ++num;
+    }
+    CHECK(feed.base() > 0);
+    CHECK(feed.pending() < 1000);
+    feed.close();
+    while (feed.next()) ++num;
+    CHECK(num == 10000 * 4 + 1);
+
+    // after dropping consumed input, offset 0 is not the beginning of the input anymore: U+FEFF is no BOM there
+    fe::Collector collector;
+    drv.set_sink(collector);
+    fe::Feed<Lexer<1>> bom(eof, [&](std::span<const char8_t> buffer) { return Lexer<1>(drv, buffer); });
+    std::string lines;
+    for (int i = 0; i != 7000; ++i) lines += "          \n";
+    bom.push(lines + "a\xef\xbb\xbf");
+    std::vector<Tok> toks;
+    while (auto tok = bom.next()) toks.emplace_back(*tok);
+    collector.take();
+    bom.push("b"); // the pending U+FEFF moves to offset 0
+    CHECK(bom.base() > 0);
+    bom.close();
+    while (auto tok = bom.next()) toks.emplace_back(*tok);
+    REQUIRE(toks.size() == 3);
+    CHECK(toks[0].to_string() == "a");
+    CHECK(toks[1].to_string() == "b");
+    CHECK(toks[1].loc() == Loc({7001, 3}, {7001, 3}));
+    auto diags = collector.take();
+    REQUIRE(diags.size() == 1); // U+FEFF is an invalid input character of this Lexer
+    CHECK(diags[0].loc == Loc({7001, 2}, {7001, 2}));
+}
+
+TEST_CASE("Lexer - relex") {
+    using Relexer = fe::Relexer<Lexer<2>>;
+    auto eof      = [](const Tok& tok) { return tok.tag() == Tok::Tag::T_EoF; };
+    fe::Driver drv;
 
+    std::string text;
+    for (int i = 0; i != 100; ++i) text += std::format("let x{} = y{} + {};\n", i, i, i);
+    auto buffer = [](const std::string& s) { return std::span<const char8_t>((const char8_t*)s.data(), s.size()); };
+
+    Relexer relexer(eof);
+    Lexer<2> lexer(drv, buffer(text));
+    relexer.lex(lexer);
+
+    // edits: replace [begin, end) by str
+    auto edit = [&](uint32_t begin, uint32_t end, std::string str) {
+        text.replace(begin, end - begin, str);
+        Lexer<2> lexer(drv, buffer(text));
+        auto change = relexer.relex(lexer, begin, end, uint32_t(str.size()));
+
+        Relexer expected(eof);
+        Lexer<2> full(drv, buffer(text));
+        expected.lex(full);
+        CHECK(relexer.size() == expected.size());
+        for (size_t i = 0; i != std::min(relexer.size(), expected.size()); ++i) {
+            CHECK(relexer.checkpoint(i) == expected.checkpoint(i));
+            CHECK(relexer[i].to_string() == expected[i].to_string());
+        }
+        return change;
+    };
+
+    auto pos    = uint32_t(text.find("y50"));
+    auto change = edit(pos, pos + 1, "zz"); // y50 -> zz50
+    CHECK(change.num_old <= 6); // out of 700 tokens
+    CHECK(change.num_new <= 6);
+    CHECK(change.delta == 1);
+
+    pos    = uint32_t(text.find(";", pos));
+    change = edit(pos, pos + 1, ";\n\nlet q = 1;"); // new lines
+    CHECK(change.num_new <= 12);
+
+    pos = uint32_t(text.find("x10 "));
+    edit(pos + 3, pos + 4, ""); // join "x10" and "="
+    edit(0, 4, "");             // at the very beginning
+    edit(uint32_t(text.size() - 1), uint32_t(text.size()), " foo"); // at the very end
+
+    // back and forth - the gap follows the edits
+    for (int i = 0; i != 20; ++i) {
+        pos = uint32_t(text.find(std::format("y{} ", i % 2 ? 90 - i : i + 2)));
+        edit(pos, pos + 1, i % 3 ? "yy" : "y\n");
+    }
+
+    edit(0, 0, "\xef\xbb\xbf"); // insert BOM
+    CHECK(relexer.checkpoint(0).offset == 3);
+    edit(0, 3, "");                // delete BOM
+    CHECK(relexer.checkpoint(0).offset == 0);
+    edit(0, 0, "\xef\xbb\xbf");
+    edit(0, 4, "\xef\xbb\xbf"); // replace BOM and first char
+}
+
+/// Identifiers, literals, `/* ... */` comments, and backticks that toggle a raw Mode, in which each line is a literal.
+class Chunky : public fe::Lexer<1, Chunky> {
+public:
+    Chunky(fe::ConcurrentSymPool& syms, std::span<const char8_t> buffer)
+        : fe::Lexer<1, Chunky>(buffer)
+        , syms_(syms) {}
+
+    struct Mode {
+        bool raw = false;
+        bool operator==(const Mode&) const = default;
+    };
+    Mode mode() const { return {raw_}; }
+    void mode(Mode mode) { raw_ = mode.raw; }
+
+    Tok lex() {
+        while (true) {
+            start();
+            if (accept(utf8::EoF)) return {loc_, Tok::Tag::T_EoF};
+            if (accept('`')) return raw_ = !raw_, Tok(loc_, Tok::Tag::T_lambda);
+            if (raw_) {
+                if (accept('\n')) continue;
+                while (accept([](char32_t c) { return c != '\n' && c != '`' && c != utf8::EoF; })) {}
+                return {loc_, uint64_t(str().size())};
+            }
+            if (accept(utf8::isspace)) continue;
+            if (accept('/')) {
+                if (!accept('*')) return {loc_, Tok::Tag::O_div};
+                while (ahead() != utf8::EoF && !(accept('*') && accept('/'))) next();
+                continue;
+            }
+            if (accept(utf8::isalpha)) {
+                while (accept(utf8::isalnum)) {}
+                return {loc_, syms_.sym(str())};
+            }
             if (accept(utf8::isdigit)) {
                 while (accept(utf8::isdigit)) {}
-                auto u = strtoull(str_.c_str(), nullptr, 10);
-                return {loc_, u};
+                return {loc_, uint64_t(str().size())};
             }
-
-            driver_.err(peek_, "invalid input character: ''{}'", utf8::Char32(ahead()));
             next();
+            return {loc_, Tok::Tag::T_semicolon};
         }
     }
 
 private:
-    fe::Driver& driver_;
+    fe::ConcurrentSymPool& syms_;
+    bool raw_ = false;
 };
 
-class Parser : public fe::Parser<Tok, Tok::Tag, 1, Parser> {};
+TEST_CASE("Lexer - split") {
+    fe::ConcurrentSymPool syms;
+    auto mk = [&](std::span<const char8_t> buffer) { return Chunky(syms, buffer); };
+
+    auto check = [&](const std::string& text, fe::SplitLexer<Chunky>::Config config) {
+        auto buffer = std::span<const char8_t>((const char8_t*)text.data(), text.size());
+        fe::SplitLexer<Chunky> split(Tok::Tag::T_EoF, mk, std::move(config));
+        auto toks = split.lex(buffer);
+
+        Chunky lexer(syms, buffer);
+        fe::TokStream<Tok, Tok::Tag> expected(lexer, Tok::Tag::T_EoF);
+        CHECK(toks.size() == expected.size());
+        for (size_t i = 0; i != std::min(toks.size(), expected.size()); ++i) {
+            CHECK(toks.tag(i) == expected.tag(i));
+            CHECK(toks.loc(i) == expected.loc(i));
+            CHECK(toks[i].to_string() == expected[i].to_string());
+        }
+        return std::pair(split.num_chunks(), split.num_relexed());
+    };
 
-template<size_t K> void test_lexer() {
+    std::string text;
+    for (int i = 0; i != 1000; ++i) text += std::format("let x{} = y{} + {};\n", i, i, i);
+    auto config = fe::SplitLexer<Chunky>::Config{.num_threads = 8, .min_chunk = 1000, .safe = {}};
+    CHECK(check(text, config) == std::pair(size_t(8), size_t(0)));
+
+    auto comment = text;
+    comment.insert(comment.size() / 4, "/*\n" + text.substr(0, text.size() / 4) + "*/"); // spans a split point
+    auto [num_chunks, num_relexed] = check(comment, config);
+    CHECK(num_chunks == 8);
+    CHECK(num_relexed >= 1);
+    CHECK(num_relexed < 8);
+
+    auto raw = text;
+    raw.insert(raw.size() / 2, "`\n" + text.substr(0, text.size() / 4) + "`"); // Mode differs at a split point
+    CHECK(check(raw, config).second >= 1);
+
+    auto unterminated = text; // the first chunk runs to the EoF itself; all others are thrown away
+    unterminated.insert(text.size() / 10, "/*");
+    CHECK(check(unterminated, config).second == 0);
+
+    size_t num_asked = 0;
+    config.num_threads = 4;
+    config.safe        = [&](std::span<const char8_t> buffer, size_t offset) {
+        ++num_asked;
+        return buffer[offset] == 'l' && offset % 2 == 0;
+    };
+    CHECK(check(text, config).second == 0);
+    CHECK(num_asked >= 3);
+
+    CHECK(check("", config) == std::pair(size_t(1), size_t(0)));
+    CHECK(check("abc /* \n", config) == std::pair(size_t(1), size_t(0)));
+}
+
+class Speculative : public fe::Parser<Tok, Tok::Tag, 2, Speculative> {
+public:
+    Speculative(fe::Driver& driver, std::u8string_view input)
+        : lexer_{{driver, std::span<const char8_t>(input)}} {
+        init(nullptr);
+    }
+
+    struct Counting { // counts how often we actually lex
+        Tok lex() { return ++num_lexed, lexer.lex(); }
+
+        ::Lexer<1> lexer;
+        size_t num_lexed = 0;
+    };
+
+    Counting& lexer() { return lexer_; }
+    void syntax_err(Tok::Tag, std::string_view) {}
+
+    /// id ('+' id)*
+    size_t parse_sum() {
+        ++num_sums;
+        size_t n = 1;
+        eat(Tok::Tag::M_id);
+        while (accept(Tok::Tag::O_add)) expect(Tok::Tag::M_id, "sum"), ++n;
+        return n;
+    }
+
+    /// sum '=' sum ';' | sum ';'
+    std::string parse_stmt() {
+        auto m     = mark();
+        auto probe = mark(); // nested
+        lex();
+        rewind(probe);
+        auto lhs = memoize(sums, [this] { return parse_sum(); });
+        if (accept(Tok::Tag::O_ass)) {
+            commit(m);
+            auto rhs = parse_sum();
+            expect(Tok::Tag::T_semicolon, "assignment");
+            return std::format("{} = {}", lhs, rhs);
+        }
+        rewind(m);
+        auto again = mark();
+        auto n     = memoize(sums, [this] { return parse_sum(); }); // memo hit: skips the sum
+        commit(again);
+        expect(Tok::Tag::T_semicolon, "expression");
+        return std::format("{}", n);
+    }
+
+    using fe::Parser<Tok, Tok::Tag, 2, Speculative>::ahead;
+
+    Memo<size_t> sums;
+    size_t num_sums = 0;
+
+private:
+    Counting lexer_;
+};
+
+TEST_CASE("Parser - speculation") {
     fe::Driver drv;
-    std::istringstream is(" test  abc    def if  \nwhile λ foo   ");
-    Lexer lexer(drv, is);
+    Speculative parser(drv, u8"a + b + c; x = y + z; d;");
+    CHECK(parser.parse_stmt() == "3");
+    CHECK(parser.num_sums == 1);
+    CHECK(parser.parse_stmt() == "1 = 2");
+    CHECK(parser.parse_stmt() == "1");
+    CHECK(parser.num_sums == 4);
+    CHECK(parser.ahead().tag() == Tok::Tag::T_EoF);
+    CHECK(parser.lexer().num_lexed == 16); // 15 tokens + 1 EoF lookahead - each lexed once
+
+    // the speculation buffer survives moving the Parser
+    std::u8string input = u8"a; ";
+    for (int i = 0; i != 1000; ++i) input += u8"x + ";
+    input += u8"y;";
+    auto source = std::make_unique<Speculative>(drv, input);
+    CHECK(source->parse_stmt() == "1");
+    auto moved = std::move(*source);
+    source.reset();
+    CHECK(moved.parse_stmt() == "1001"); // buffers 2000 tokens while speculating
+}
 
-    auto t1 = lexer.lex();
-    auto t2 = lexer.lex();
-    auto t3 = lexer.lex();
-    auto t4 = lexer.lex();
-    auto t5 = lexer.lex();
-    auto t6 = lexer.lex();
-    auto t7 = lexer.lex();
-    auto t8 = lexer.lex();
-    auto t9 = lexer.lex();
-    auto s  = std::format("{} {} {} {} {} {} {} {} {}", t1, t2, t3, t4, t5, t6, t7, t8, t9);
-    CHECK(s == "test abc def if while λ foo <end of file> <end of file>");
+TEST_CASE("Stats") {
+    fe::Stats::clear_global();
+    auto input = std::u8string_view(u8"a + b + c; x = y + z; d;");
+    fe::Driver drv;
+    {
+        Speculative parser(drv, input);
+        parser.parse_stmt(), parser.parse_stmt(), parser.parse_stmt();
+    } // records Lexer & Parser
+    {
+        fe::Arena arena(1024);
+        for (int i = 0; i != 100; ++i) (void)arena.allocate(100);
+        (void)arena.allocate(4096);
+    }
+    drv.sym("ab"), drv.sym("long_symbol"), drv.sym("long_symbol");
+
+    auto stats = drv.stats();
+    if constexpr (fe::Enable_Stats) {
+        CHECK(stats.lexer.tokens >= 15); // + whitespace
+        CHECK(stats.lexer.bytes == input.size());
+        CHECK(stats.lexer.chars == input.size());
+        CHECK(stats.parser.fills == 16);
+        CHECK(stats.parser.replays > 0);
+        CHECK(stats.arena.large == 1);
+        CHECK(stats.arena.pages >= 10);
+        CHECK(stats.arena.used >= 100 * 100 + 4096);
+        CHECK(stats.arena.waste >= 9 * 24);
+        CHECK(stats.arena.used > fe::Stats::global().arena.used); // "long_symbol" in the Driver's live SymPool
+        CHECK(stats.sym.lookups >= 3);
+        CHECK(stats.sym.packed >= 1);
+        CHECK(stats.sym.hits >= 1);
+    } else {
+        CHECK(stats.lexer.tokens == 0);
+        CHECK(stats.arena.allocations == 0);
+        CHECK(stats.sym.lookups == 0);
+    }
 
-    // clang-format off
-    CHECK(t1.loc() == Loc({1,  2}, {1,  5}));
-    CHECK(t2.loc() == Loc({1,  8}, {1, 10}));
-    CHECK(t3.loc() == Loc({1, 15}, {1, 17}));
-    CHECK(t4.loc() == Loc({1, 19}, {1, 20}));
-    CHECK(t5.loc() == Loc({2,  1}, {2,  5}));
-    CHECK(t6.loc() == Loc({2,  7}, {2,  7}));
-    CHECK(t7.loc() == Loc({2,  9}, {2, 11}));
-    CHECK(t8.loc() == Loc({2, 14}, {2, 14}));
-    CHECK(t9.loc() == Loc({2, 14}, {2, 14}));
-    // clang-format on
+    std::ostringstream os;
+    drv.dump_stats(os);
+    CHECK(os.str().find("tokens/s") != std::string::npos);
 }
 
-TEST_CASE("Lexer") {
-    test_lexer<1>();
-    test_lexer<2>();
-    test_lexer<3>();
+class Streaming : public fe::StreamParser<Tok, Tok::Tag, Streaming> {
+public:
+    Streaming(const fe::TokStream<Tok, Tok::Tag>& stream) { init(stream, nullptr); }
+
+    void syntax_err(Tok::Tag, std::string_view) { ++num_errs; }
+
+    /// 'let' id '=' expr ';' - with recovery
+    std::string parse_let() {
+        auto track = tracker();
+        eat(Tok::Tag::K_let);
+        auto id = expect(Tok::Tag::M_id, "let");
+        expect(Tok::Tag::O_ass, "let");
+        auto n = parse_expr();
+        if (!accept(Tok::Tag::T_semicolon)) {
+            syntax_err(Tok::Tag::T_semicolon, "let");
+            skip_to({Tok::Tag::T_semicolon});
+            eat(Tok::Tag::T_semicolon);
+        }
+        loc = track;
+        return std::format("{}:{}", id, n);
+    }
+
+    /// Number of tokens within an expression; a parenthesized one is skipped as a whole.
+    size_t parse_expr() {
+        if (ahead_tag() == Tok::Tag::D_paren_l) {
+            auto close = stream().match(pos(), Tok::Tag::D_paren_l, Tok::Tag::D_paren_r);
+            for (auto i = pos(); i <= close; ++i) lex();
+            return 1;
+        }
+        size_t n = 1;
+        lex();
+        while (ahead_tag() == Tok::Tag::O_add || ahead_tag() == Tok::Tag::O_mul) lex(), lex(), n += 2;
+        return n;
+    }
+
+    using fe::StreamParser<Tok, Tok::Tag, Streaming>::ahead;
+
+    Loc loc;
+    size_t num_errs = 0;
+};
+
+TEST_CASE("Parser - stream") {
+    fe::Driver drv;
+    std::u8string_view input = u8"let a = (b + (c)) * d; let e = f g h; let i = j + k;";
+    Lexer<1> lexer(drv, std::span<const char8_t>(input));
+    fe::TokStream<Tok, Tok::Tag> toks(lexer, Tok::Tag::T_EoF);
+
+    CHECK(toks.size() == 28);
+    CHECK(toks.tags().size() == toks.size());
+    CHECK(toks.tag(27) == Tok::Tag::T_EoF);
+    CHECK(toks.count(Tok::Tag::K_let) == 3);
+    CHECK(toks.find(Tok::Tag::T_semicolon) == 12);
+    CHECK(toks.find(Tok::Tag::T_semicolon, 13) == 19);
+    CHECK(toks.find(Tok::Tag::T_lambda) == toks.size());
+    CHECK(toks.find({Tok::Tag::O_mul, Tok::Tag::O_ass}, 3) == 10);
+    CHECK(toks.match(3, Tok::Tag::D_paren_l, Tok::Tag::D_paren_r) == 9);
+    CHECK(toks.match(6, Tok::Tag::D_paren_l, Tok::Tag::D_paren_r) == 8);
+    CHECK(toks.loc(3) == Loc({1, 9}, {1, 9}));
+
+    Streaming parser(toks);
+    CHECK(parser.ahead(123).tag() == Tok::Tag::T_EoF); // unbounded lookahead
+    CHECK(parser.parse_let() == "a:1");
+    CHECK(parser.ahead().tag() == Tok::Tag::K_let);
+    CHECK(parser.num_errs == 1);
+    CHECK(parser.parse_let() == "e:1");
+    CHECK(parser.num_errs == 2);
+    CHECK(parser.loc == Loc({1, 24}, {1, 37}));
+    CHECK(parser.parse_let() == "i:3");
+    CHECK(parser.num_errs == 2);
+    CHECK(parser.ahead().tag() == Tok::Tag::T_EoF);
 }
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <charconv>
+
+#include <fe/driver.h>
+#include <fe/keyword.h>
+#include <fe/lexer.h>
+#include <fe/punct.h>
+
+// A reference Lexer for a tiny language - used by fe-test and fe-bench.
+
+using fe::Loc;
+using fe::Pos;
+using fe::Sym;
+
+namespace utf8 = fe::utf8;
+
+#define LET_KEY(m) m(K_let, "let") m(K_return, "return")
+
+#define LET_MISC(m) m(M_id, "<identifier>") m(M_lit, "<literal>")
+
+#define LET_PUNCT(m) m(D_paren_l, "(") m(D_paren_r, ")") m(T_semicolon, ";") m(T_lambda, "λ")
+
+#define LET_TOK(m) LET_PUNCT(m) m(T_EoF, "<end of file>")
+
+#define LET_OP(m)                                                                                       \
+    m(O_add, "+", Add, true) m(O_sub, "-", Add, true) m(O_mul, "*", Mul, true) m(O_div, "/", Mul, true) \
+        m(O_ass, "=", ASS, false)
+
+class Tok {
+public:
+    enum Tag {
+#define CODE(t, str) t,
+        LET_KEY(CODE) LET_MISC(CODE) LET_TOK(CODE)
+#undef CODE
+#define CODE(t, str, prec, left_assoc) t,
+            LET_OP(CODE)
+#undef CODE
+    };
+
+    enum Prec { Err, Bot, Ass, Add, Mul };
+
+    Tok() {}
+    Tok(Loc loc, Tag tag)
+        : loc_(loc)
+        , tag_(tag) {}
+    Tok(Loc loc, Sym sym)
+        : loc_(loc)
+        , tag_(Tag::M_id)
+        , sym_(sym) {}
+    Tok(Loc loc, uint64_t u64)
+        : loc_(loc)
+        , tag_(Tag::M_lit)
+        , u64_(u64) {}
+
+    Tag tag() const { return tag_; }
+    Loc loc() const { return loc_; }
+
+    static const char* tag2str(Tag tag) {
+        switch (tag) {
+#define CODE(t, str) \
+    case Tok::Tag::t: return str;
+            LET_KEY(CODE)
+            LET_TOK(CODE)
+            LET_MISC(CODE)
+#undef CODE
+#define CODE(t, str, prec, left_assoc) \
+    case Tok::Tag::t: return str;
+            LET_OP(CODE)
+#undef CODE
+            default: fe::unreachable();
+        }
+    }
+
+    std::string to_string() const {
+        if (tag_ == M_id) return sym_.str();
+        if (tag_ == M_lit) return std::to_string(u64_);
+        return tag2str(tag_);
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, Tok tok) { return os << tok.to_string(); }
+
+private:
+    Loc loc_;
+    Tag tag_;
+    union {
+        Sym sym_;
+        uint64_t u64_;
+    };
+};
+
+template<> struct std::formatter<Tok> : fe::ostream_formatter {};
+
+static constexpr auto Keywords = fe::mk_keywords<Tok::Tag>({
+#define CODE(t, str) {str, Tok::Tag::t},
+    LET_KEY(CODE)
+#undef CODE
+});
+
+static constexpr auto Puncts = fe::mk_punctuators<Tok::Tag>({
+#define CODE(t, str) {str, Tok::Tag::t},
+    LET_PUNCT(CODE)
+#undef CODE
+#define CODE(t, str, prec, left_assoc) {str, Tok::Tag::t},
+    LET_OP(CODE)
+#undef CODE
+});
+
+template<size_t K = 1> class Lexer : public fe::Lexer<K, Lexer<K>> {
+public:
+    using fe::Lexer<K, Lexer<K>>::ahead;
+    using fe::Lexer<K, Lexer<K>>::accept;
+    using fe::Lexer<K, Lexer<K>>::next;
+    using fe::Lexer<K, Lexer<K>>::str;
+
+    using fe::Lexer<K, Lexer<K>>::loc_;
+    using fe::Lexer<K, Lexer<K>>::peek_;
+
+    Lexer(fe::Driver& driver, std::istream& istream, const std::filesystem::path* path = nullptr)
+        : fe::Lexer<K, Lexer<K>>(istream, path)
+        , driver_(driver) {}
+    Lexer(fe::Driver& driver, std::span<const char8_t> buffer, const std::filesystem::path* path = nullptr)
+        : fe::Lexer<K, Lexer<K>>(buffer, path)
+        , driver_(driver) {}
+
+    Tok lex() {
+        while (true) {
+            this->start();
+
+            if (accept(utf8::Null)) {
+                std::cerr << "invalid UTF-8 sequence" << std::endl;
+                continue;
+            }
+
+            if (accept(utf8::EoF)) return {loc_, Tok::Tag::T_EoF};
+            if (accept(utf8::isspace)) continue;
+
+            if (auto punct = this->accept_longest(Puncts)) return {loc_, punct->tag};
+
+            if (accept([](char32_t c) { return c == '_' || utf8::isalpha(c); })) {
+                while (accept([](char32_t c) { return c == '_' || c == '.' || utf8::isalnum(c); })) {}
+                if (auto keyword = Keywords.find(str())) return {loc_, keyword->tag};
+                return {loc_, driver_.sym(str())};
+            }
+
+            if (accept(utf8::isdigit)) {
+                while (accept(utf8::isdigit)) {}
+                uint64_t u = 0;
+                std::from_chars(str().data(), str().data() + str().size(), u);
+                return {loc_, u};
+            }
+
+            driver_.err(peek_, "invalid input character: ''{}'", utf8::Char32(ahead()));
+            next();
+        }
+    }
+
+private:
+    fe::Driver& driver_;
+};
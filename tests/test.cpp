@@ -1,10 +1,26 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 
+#include <cctype>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
 #include <doctest/doctest.h>
 #include <fe/arena.h>
+#include <fe/batch.h>
+#include <fe/cast.h>
+#include <fe/driver.h>
+#include <fe/fold.h>
+#include <fe/format.h>
 #include <fe/ring.h>
+#include <fe/source.h>
 #include <fe/sym.h>
 #include <fe/utf8.h>
+#include <fe/xid.h>
 
 using namespace std::literals;
 
@@ -14,6 +30,384 @@ TEST_CASE("Arena") {
     for (int i = 0, e = 10000; i != e; ++i) v.emplace_back(i);
 }
 
+TEST_CASE("Arena - reset/scope/pool") {
+    fe::Arena::PagePool pool(64);
+    {
+        fe::Arena arena(pool);
+        auto p1 = (char*)arena.allocate(16);
+        {
+            auto scope = arena.scope();
+            for (int i = 0; i != 40; ++i) (void)arena.allocate(16); // crosses several pages
+        }
+        CHECK(arena.num_pages() == 11);
+        CHECK(arena.allocate(16) == p1 + 16); // rewound across page boundaries
+
+        arena.reset();
+        CHECK(arena.allocate(16) == p1);
+        for (int i = 0; i != 4; ++i) (void)arena.allocate(16); // reuses retained page
+        CHECK(arena.num_pages() == 11);
+
+        (void)arena.allocate(1000); // too big for a page
+        CHECK(arena.num_large() == 1);
+        arena.reset();
+        CHECK(arena.num_large() == 0);
+
+        (void)arena.allocate(16);
+        arena.trim(); // all but the first page
+        CHECK(pool.num_free() == 10);
+    }
+    CHECK(pool.num_free() == 11);
+
+    fe::Arena arena(pool);
+    (void)arena.allocate(16);
+    CHECK(pool.num_free() == 10);
+}
+
+TEST_CASE("Arena - config/large objects") {
+    fe::Arena arena(fe::Arena::Config{.page_size = 64, .max_page_size = 256, .growth = 2, .page_align = 64});
+    auto p1 = (char*)arena.allocate(8);
+    CHECK((uintptr_t)p1 % 64 == 0);
+    (void)arena.allocate(100);             // large object
+    CHECK(arena.allocate(8) == p1 + 8);    // current page is still live
+    CHECK(arena.num_large() == 1);
+    CHECK(arena.reserved() == 64 + 100);
+    CHECK(arena.used() == 16 + 100);
+
+    for (int i = 0; i != 6; ++i) (void)arena.allocate(16); // enforce two page switches
+    CHECK(arena.num_pages() == 2);
+    CHECK(arena.reserved() == 64 + 128 + 100);
+    CHECK(arena.used() == 64 + 48 + 100);
+
+    arena.reset();
+    CHECK(arena.used() == 0);
+    CHECK(arena.reserved() == 64 + 128);
+}
+
+namespace {
+struct Counted {
+    Counted(int& num_dtors, int i)
+        : num_dtors(num_dtors)
+        , i(i) {}
+    ~Counted() { ++num_dtors; }
+
+    int& num_dtors;
+    int i;
+};
+
+struct Trivial {
+    int i;
+};
+
+/// Only owns memory of its Arena - no need to destroy it.
+struct Node {
+    Node(fe::Arena& arena)
+        : ops(arena.allocator<Node*>()) {}
+
+    std::vector<Node*, fe::Arena::Allocator<Node*>> ops;
+};
+} // namespace
+
+template<> inline constexpr bool fe::needs_dtor<Node> = false;
+
+TEST_CASE("Arena - create/Pool") {
+    int num_dtors = 0;
+    {
+        fe::Arena arena;
+        for (int i = 0; i != 100; ++i) CHECK(arena.create<Trivial>(i)->i == i);
+        CHECK(arena.num_dtors() == 0);
+        auto node = arena.create<Node>(arena);
+        node->ops.emplace_back(arena.create<Node>(arena));
+        CHECK(arena.num_dtors() == 0);
+
+        for (int i = 0; i != 10; ++i) arena.create<Counted>(num_dtors, i);
+        CHECK(arena.num_dtors() == 10);
+        {
+            auto scope = arena.scope();
+            arena.create<Counted>(num_dtors, 10);
+            CHECK(arena.num_dtors() == 11);
+        }
+        CHECK(num_dtors == 1);
+        CHECK(arena.num_dtors() == 10);
+
+        auto moved = std::move(arena);
+        CHECK(arena.num_dtors() == 0);
+        CHECK(moved.num_dtors() == 10);
+        CHECK(num_dtors == 1);
+    }
+    CHECK(num_dtors == 11);
+
+    num_dtors = 0;
+    fe::Arena arena;
+    {
+        fe::Pool<Counted> pool(arena);
+        auto a = pool.mk(num_dtors, 1);
+        auto b = pool.mk(num_dtors, 2);
+        pool.mk(num_dtors, 3);
+        pool.recycle(a);
+        pool.recycle(b);
+        CHECK(num_dtors == 2);
+        CHECK(pool.num_live() == 1);
+        CHECK(pool.num_free() == 2);
+
+        auto used = arena.used();
+        auto c    = pool.mk(num_dtors, 4);
+        CHECK((void*)c == (void*)b); // LIFO
+        CHECK(c->i == 4);
+        CHECK(pool.mk(num_dtors, 5) == (void*)a);
+        CHECK(arena.used() == used);
+        CHECK(pool.num_free() == 0);
+        CHECK(arena.num_dtors() == 0);
+    }
+    CHECK(num_dtors == 5);
+
+    fe::Pool<Trivial> trivial(arena);
+    auto t = trivial.mk(23);
+    trivial.recycle(t);
+    CHECK(trivial.mk(42) == t);
+    CHECK(t->i == 42);
+
+    // A Scope opened behind the Pool's last slot may rewind freely.
+    {
+        fe::Arena::Scope scope(arena);
+        (void)arena.allocate(100);
+    }
+    trivial.recycle(t);
+    CHECK(trivial.mk(5) == t);
+    CHECK(trivial.mk(6) != t);
+}
+
+TEST_CASE("ConcurrentArena") {
+    fe::ConcurrentArena arena(fe::Arena::Config{.page_size = 4096, .max_page_size = 4096});
+    constexpr int Num_Threads = 4, Num_Elems = 10000;
+    std::vector<std::thread> threads;
+    std::vector<int> sums(Num_Threads);
+    for (int t = 0; t != Num_Threads; ++t)
+        threads.emplace_back([&, t]() {
+            std::vector<int, fe::Arena::Allocator<int>> v(arena.allocator<int>());
+            for (int i = 0; i != Num_Elems; ++i) v.emplace_back(*arena.mk<int>(i));
+            for (auto i : v) sums[t] += i;
+            CHECK(&arena.local() == &arena.local());
+        });
+    for (auto& thread : threads) thread.join();
+
+    for (auto sum : sums) CHECK(sum == Num_Elems * (Num_Elems - 1) / 2);
+    CHECK(arena.num_arenas() == Num_Threads);
+    CHECK(arena.used() > Num_Threads * Num_Elems * sizeof(int));
+    arena.reset();
+    CHECK(arena.used() == 0);
+
+    // alternate between more ConcurrentArenas than are cached
+    std::vector<std::unique_ptr<fe::ConcurrentArena>> arenas;
+    for (size_t i = 0; i != fe::ConcurrentArena::Num_Cached + 1; ++i)
+        arenas.emplace_back(std::make_unique<fe::ConcurrentArena>());
+    std::vector<fe::Arena*> locals;
+    for (auto& a : arenas) locals.emplace_back(&a->local());
+    for (int round = 0; round != 3; ++round)
+        for (size_t i = 0; i != arenas.size(); ++i) CHECK(&arenas[i]->local() == locals[i]);
+    for (auto& a : arenas) CHECK(a->num_arenas() == 1);
+}
+
+TEST_CASE("Batch") {
+    std::vector<std::filesystem::path> paths;
+    for (int i = 0; i != 64; ++i) paths.emplace_back(std::format("file_{}.let", i));
+
+    fe::ConcurrentSymPool syms;
+    fe::Collector collector;
+    fe::Batch batch(syms, {.num_threads = 4, .arena = {}}, &collector);
+    auto res = batch.run(paths, [](fe::Batch::Job& job) {
+        auto i = job.index();
+        if (i % 8 == 0) std::this_thread::sleep_for(1ms); // provoke stealing
+        if (i % 2) job.err(fe::Loc(&job.path(), {1, 1}), "odd #{}", i);
+        if (i % 3 == 0) job.warn({}, "multiple of three");
+        auto ints = job.arena().allocate<int>(i + 1);
+        for (size_t j = 0; j <= i; ++j) ints[j] = int(j);
+        return std::pair(job.sym("a shared symbol"), job.sym(job.path().string()));
+    });
+
+    REQUIRE(res.size() == paths.size());
+    for (size_t i = 0; i != res.size(); ++i) {
+        CHECK(res[i].first == res[0].first);
+        CHECK(res[i].second == syms.sym(paths[i].string()));
+    }
+    CHECK(batch.num_errors() == 32);
+    CHECK(batch.num_warnings() == 22);
+
+    auto diags = collector.take();
+    REQUIRE(diags.size() == 54);
+    CHECK(diags[0].kind == fe::Diag::Kind::Warn); // file_0
+    CHECK(diags[1].msg == "odd #1");
+    CHECK(diags[2].msg == "odd #3");
+    CHECK(diags[3].kind == fe::Diag::Kind::Warn); // still file_3
+    CHECK(diags[4].msg == "odd #5");
+
+    size_t n = 0; // void callbacks are fine, too
+    batch.run(std::span(paths).first(3), [&n](fe::Batch::Job&) { ++n; });
+    CHECK(n == 3);
+
+    auto odd = batch.run(paths, [](fe::Batch::Job& job) { return job.index() % 2 == 1; }); // std::vector<bool>
+    REQUIRE(odd.size() == paths.size());
+    for (size_t i = 0; i != odd.size(); ++i) CHECK(odd[i] == (i % 2 == 1));
+
+    // exceptions are rethrown after all Jobs are done - the first one in the order of the paths
+    std::atomic<size_t> num_run = 0;
+    auto fail                   = [&](fe::Batch::Job& job) {
+        ++num_run;
+        job.note({}, "about to fail");
+        if (job.index() % 10 == 5) throw std::runtime_error(std::format("#{}", job.index()));
+    };
+    CHECK_THROWS_WITH(batch.run(paths, fail), "#5");
+    CHECK(num_run == paths.size());
+    CHECK(collector.take().size() == paths.size());
+}
+
+namespace {
+enum class Kind : uint8_t { Lit, Var, Add, Mul, Let, Fun };
+
+struct AST : public fe::RuntimeCast<AST> {
+    AST(Kind node)
+        : node_(node) {}
+    virtual ~AST() = default;
+
+    Kind node() const { return node_; }
+
+    Kind node_;
+};
+
+// clang-format off
+struct Expr    : public AST     { static constexpr auto First_Node = Kind::Lit, Last_Node = Kind::Mul; using Node_Range_Of = Expr;    using AST::AST; };
+struct Lit     : public Expr    { static constexpr auto Node = Kind::Lit; Lit() : Expr(Node) {} };
+struct Var     : public Expr    { static constexpr auto Node = Kind::Var; Var() : Expr(Node) {} };
+struct BinExpr : public Expr    { static constexpr auto First_Node = Kind::Add, Last_Node = Kind::Mul; using Node_Range_Of = BinExpr; using Expr::Expr; };
+struct Add     : public BinExpr { static constexpr auto Node = Kind::Add; Add() : BinExpr(Node) {} };
+struct Mul     : public BinExpr { static constexpr auto Node = Kind::Mul; Mul() : BinExpr(Node) {} };
+struct Decl    : public AST     { static constexpr auto First_Node = Kind::Let, Last_Node = Kind::Fun; using Node_Range_Of = Decl;    using AST::AST; };
+struct Let     : public Decl    { static constexpr auto Node = Kind::Let; Let() : Decl(Node) {} };
+struct Fun     : public Decl    { static constexpr auto Node = Kind::Fun; Fun() : Decl(Node) {} };
+struct Unary   : public Expr    { using Expr::Expr; }; // no range of its own - and none of the nodes above
+// clang-format on
+} // namespace
+
+TEST_CASE("RuntimeCast") {
+    Lit lit;
+    Var var;
+    Add add;
+    Mul mul;
+    Let let;
+    Fun fun;
+    const AST* all[] = {&lit, &var, &add, &mul, &let, &fun};
+
+    for (auto ast : all) {
+        auto n = (int)ast->node();
+        CHECK((ast->isa<Expr>() != nullptr) == (n <= 3));
+        CHECK((ast->isa<BinExpr>() != nullptr) == (n == 2 || n == 3));
+        CHECK((ast->isa<Decl>() != nullptr) == (n >= 4));
+        CHECK((ast->isa<Add>() != nullptr) == (n == 2));
+        CHECK(ast->isa<Unary>() == nullptr);
+        CHECK((ast->isa<Expr>() != nullptr) == (dynamic_cast<const Expr*>(ast) != nullptr));
+        CHECK((ast->isa<Lit, Fun>() != nullptr) == (n == 0 || n == 5));
+    }
+    CHECK(all[3]->as<BinExpr>() == &mul);
+
+    auto visit = [](const AST* ast) {
+        return ast->visit<Lit, Mul, Let>(fe::Overload{
+            [](const Lit*) { return 1; },
+            [](const Mul*) { return 2; },
+            [](const Let*) { return 3; },
+            [](const AST* ast) { return ast->isa<Expr>() ? 4 : 5; },
+        });
+    };
+    CHECK(visit(&lit) == 1);
+    CHECK(visit(&var) == 4);
+    CHECK(visit(&add) == 4);
+    CHECK(visit(&mul) == 2);
+    CHECK(visit(&let) == 3);
+    CHECK(visit(&fun) == 5); // beyond the table
+
+    AST* ast = &add;
+    CHECK(ast->visit<Add>([](auto* ast) { return std::is_same_v<decltype(ast), Add*>; }));
+}
+
+TEST_CASE("Driver - diagnostics") {
+    fe::Driver driver;
+    fe::Collector collector;
+    driver.set_sink(collector);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t != 4; ++t)
+        threads.emplace_back([&driver, t] {
+            for (int i = 0; i != 100; ++i) driver.err(fe::Pos(t + 1, i + 1), "error {} from thread {}", i, t);
+        });
+    for (auto& thread : threads) thread.join();
+    CHECK(driver.num_errors() == 400);
+    CHECK(collector.take().size() == 400);
+
+    std::filesystem::path path("a\\b.let");
+    driver.warn({&path, {1, 2}, {1, 4}}, "\"{}\"", "x");
+    driver.note({}, "see {}", 23);
+    CHECK(driver.num_warnings() == 1);
+    std::ostringstream json;
+    collector.json(json);
+    CHECK(json.str()
+          == R"([{"kind": "warning", "file": "a\\b.let", "begin": [1, 2], "finis": [1, 4], "msg": "\"x\""}, )"
+             R"({"kind": "note", "file": "", "begin": [0, 0], "finis": [0, 0], "msg": "see 23"}])");
+
+    fe::Filter filter(collector, 2);
+    driver.set_sink(filter);
+    collector.take();
+    for (int i = 0; i != 3; ++i) driver.warn(fe::Pos(1, 1), "same");
+    driver.warn(fe::Pos(2, 1), "other");
+    driver.warn(fe::Pos(3, 1), "too many");
+    driver.err(fe::Pos(3, 1), "too many");
+    CHECK(collector.diags().size() == 3);
+    CHECK(filter.num_dropped() == 3);
+
+    std::ostringstream oss;
+    fe::BufferedSink buffered(oss, 256);
+    driver.set_sink(buffered);
+    driver.warn(fe::Pos(1, 1), "first");
+    CHECK(oss.str().empty()); // still buffered
+    driver.err(fe::Pos(2, 1), "second");
+    CHECK(oss.str().empty()); // errors, too
+    driver.flush();
+    CHECK(oss.str() == "<unknown file>:1:1: warning: first\n<unknown file>:2:1: error: second\n");
+
+    std::ostringstream eager;
+    fe::BufferedSink flushing(eager, 256, true);
+    driver.set_sink(flushing);
+    driver.warn(fe::Pos(1, 1), "first");
+    CHECK(eager.str().empty());
+    driver.err(fe::Pos(2, 1), "second");
+    CHECK(eager.str() == "<unknown file>:1:1: warning: first\n<unknown file>:2:1: error: second\n"); // errors flush
+    driver.set_sink(buffered);
+
+    auto moved = std::move(driver);
+    CHECK(moved.num_errors() == 403);
+    CHECK(moved.num_warnings() == 8);
+    CHECK(&moved.sink() == &buffered);
+    CHECK(moved.sym("abcdefghijkl") == moved.sym("abcdefghijkl"));
+}
+
+TEST_CASE("format") {
+    std::filesystem::path path("foo.let");
+    fe::SymPool syms;
+    CHECK(std::format("{}", fe::Pos()) == "<unknown position>");
+    CHECK(std::format("{}", fe::Pos(3)) == "3");
+    CHECK(std::format("{} {}", fe::Pos(3, 4), fe::Pos(5, 6)) == "3:4 5:6");
+    CHECK(std::format("{}", fe::Loc()) == "<unknown location>");
+    CHECK(std::format("{}", fe::Loc(&path, {1, 2}, {1, 2})) == "foo.let:1:2");
+    CHECK(std::format("{}", fe::Loc(&path, {1, 2}, {1, 5})) == "foo.let:1:2-5");
+    CHECK(std::format("{}", fe::Loc(&path, {1, 2}, {3, 4})) == "foo.let:1:2-3:4");
+    CHECK(std::format("{}", fe::Loc(nullptr, {1, 2}, {3, 4})) == "<unknown file>:1:2-3:4");
+    CHECK(std::format("<{}> <{}>", syms.sym("ab"), syms.sym("abcdefghijkl")) == "<ab> <abcdefghijkl>");
+    CHECK(std::format("[{}]", fe::Tab("  ", 3)) == "[      ]");
+    CHECK(std::format("{}{}", fe::utf8::Char32('a'), fe::utf8::Char32(U'λ')) == "aλ");
+
+    // operator<< shares the implementation
+    std::ostringstream os;
+    os << fe::Loc(&path, {1, 2}, {3, 4}) << ' ' << fe::Pos(7);
+    CHECK(os.str() == "foo.let:1:2-3:4 7");
+}
+
 TEST_CASE("Ring") {
     fe::Ring<int, 1> ring1;
     ring1[0] = 0;
@@ -59,6 +453,78 @@ TEST_CASE("Ring") {
     CHECK(ring3[0] == 3);
     CHECK(ring3[1] == 4);
     CHECK(ring3[2] == 5);
+
+    // put an element of the Ring itself
+    fe::Ring<std::string, 2> strs;
+    strs[0] = "a long string beyond SSO";
+    strs[1] = "another long string beyond SSO";
+    strs.put(strs[1]);
+    CHECK(strs[0] == "another long string beyond SSO");
+    CHECK(strs[1] == "another long string beyond SSO");
+    strs.put(strs[0]);
+    CHECK(strs[0] == "another long string beyond SSO");
+    CHECK(strs[1] == "another long string beyond SSO");
+}
+
+template<size_t N> void test_ring_move() {
+    fe::Ring<std::unique_ptr<int>, N> ring;
+    for (int i = 0; i != int(N); ++i) ring.put(std::make_unique<int>(i));
+    for (int i = int(N); i != 3 * int(N) + 1; ++i) {
+        auto p     = ring.front().get();
+        auto front = std::move(ring.front());
+        CHECK(*front == i - int(N));
+        auto& last = i % 2 ? ring.put(std::make_unique<int>(i)) : ring.emplace(new int(i));
+        CHECK(*last == i);
+        CHECK(*ring[N - 1] == i);
+        if constexpr (N > 1) CHECK(ring.front().get() != p);
+    }
+
+    auto copy = std::move(ring);
+    CHECK(*copy.front() == 2 * int(N) + 1);
+}
+
+TEST_CASE("Ring - move-only") {
+    test_ring_move<1>();
+    test_ring_move<2>();
+    test_ring_move<3>();
+    test_ring_move<4>();
+}
+
+TEST_CASE("SourceManager") {
+    fe::SourceManager sm;
+    auto a = sm.add("a.let", u8"ab\nλx\n\nlast");
+    auto b = sm.add("b.let", u8"b");
+    CHECK(a->base() == 1);
+    CHECK(b->base() == a->base() + a->size() + 1);
+    CHECK(a->num_lines() == 4);
+    CHECK(sm.file(0) == nullptr);
+    CHECK(sm.file(a->base()) == a);
+    CHECK(sm.file(b->base() + 1) == b); // one past the end
+    CHECK(sm.file(b->base() + 2) == nullptr);
+
+    auto lambda = a->sloc(3, 6); // "λx"
+    CHECK(sm.str(lambda) == "a.let:2:1-2");
+    CHECK(sm.loc(lambda) == fe::Loc(&a->path(), {2, 1}, {2, 2}));
+    CHECK(sm.str(a->sloc(0, 7)) == "a.let:1:1-2:3");
+    CHECK(sm.str(a->sloc(8, 12)) == "a.let:4:1-4");
+    CHECK(sm.str(b->sloc(0, 1)) == "b.let:1:1");
+    CHECK(sm.str({}) == "<unknown location>");
+    static_assert(sizeof(fe::SLoc) == 8);
+
+    std::u8string big;
+    for (int i = 0; i != 100000; ++i) big += u8"line\n";
+    auto c = sm.add("c.let", std::move(big));
+    CHECK(c->num_lines() == 100001);
+    CHECK(sm.str(c->sloc(5 * 99999, 5 * 99999 + 4)) == "c.let:100000:1-4");
+    CHECK(sm.loc(c->sloc(5 * 99999, 5 * 99999)).begin.row == 0xffff); // saturates
+
+    size_t n = 0;
+    std::u8string_view text = u8"\n-----------------\n---------------------------------\n";
+    fe::utf8::scan(text.data(), text.data() + text.size(), '\n', [&](const char8_t* p) {
+        CHECK(*p == '\n');
+        ++n;
+    });
+    CHECK(n == 3);
 }
 
 TEST_CASE("Sym") {
@@ -110,6 +576,304 @@ TEST_CASE("Sym") {
     CHECK(empty.empty());
     CHECK(empty.size() == 0);
     CHECK(!empty);
+
+    std::vector<fe::Sym> many; // enforce a couple of rehashes
+    for (int i = 0; i != 10000; ++i) many.emplace_back(syms.sym("long_symbol_" + std::to_string(i)));
+    for (int i = 0; i != 10000; ++i) CHECK(many[i] == syms.sym("long_symbol_" + std::to_string(i)));
+
+    CHECK(syms.sym_fold("Abc") == syms.sym("abc"));
+    CHECK(syms.sym_fold("Long_Symbol_42") == many[42]);
+    CHECK(syms.sym_fold("ΣΊΣΥΦΟΣ") == syms.sym_fold("σίσυφοσ"));
+    CHECK(syms.sym_fold("ΣΊΣΥΦΟΣ").view() == "σίσυφοσ");
+    CHECK(syms.sym_fold("") == fe::Sym());
+    CHECK(syms.sym_fold("\xc3" "A_truncated") == syms.sym_fold("\xc3" "a_truncated"));
+}
+
+TEST_CASE("SymPool - snapshot") {
+    auto name = [](int i) { return "long_symbol_" + std::to_string(i); };
+
+    std::ostringstream oss;
+    {
+        fe::SymPool syms;
+        for (int i = 0; i != 1000; ++i) syms.sym(name(i));
+        syms.sym("ab"); // short ones don't end up in the image
+        CHECK(syms.size() == 1000);
+        syms.dump(oss);
+    }
+
+    auto str = oss.str();
+    std::vector<uint64_t> buf((str.size() + 7) / 8); // load wants the alignment MMap would give us
+    std::memcpy(buf.data(), str.data(), str.size());
+    auto image = std::span<const char8_t>((const char8_t*)buf.data(), str.size());
+    auto begin = (const char*)buf.data(), end = begin + str.size();
+
+    fe::SymPool syms;
+    REQUIRE(syms.load(image));
+    CHECK(syms.size() == 1000);
+    CHECK(syms.num_ordinals() == 1000); // the image's Strings come numbered
+    for (int i = 0; i != 1000; ++i) {
+        auto sym = syms.sym(name(i));
+        CHECK(syms.find_ordinal(sym) < 1000);
+        CHECK(sym.view() == name(i));
+        CHECK(begin <= sym.c_str());
+        CHECK(sym.c_str() < end); // no copy
+    }
+
+    // new ones go on top
+    auto fresh = syms.sym("fresh_symbol");
+    CHECK((fresh.c_str() < begin || end <= fresh.c_str()));
+    CHECK(fresh == syms.sym("fresh_symbol"));
+    CHECK(syms.size() == 1001);
+    CHECK(syms.ordinal(fresh) == 1000);
+
+    // a snapshot of a loaded pool contains both
+    std::ostringstream again;
+    syms.dump(again);
+    auto str2 = again.str();
+    std::vector<uint64_t> buf2((str2.size() + 7) / 8);
+    std::memcpy(buf2.data(), str2.data(), str2.size());
+    fe::SymPool syms2;
+    REQUIRE(syms2.load(std::span<const char8_t>((const char8_t*)buf2.data(), str2.size())));
+    CHECK(syms2.size() == 1001);
+    CHECK(syms2.sym("fresh_symbol").view() == "fresh_symbol");
+    CHECK(syms2.sym(name(42)).view() == name(42));
+
+    // different String::Hash: falls back to copying
+    buf2[1] ^= 1; // Header::probe
+    fe::SymPool copied;
+    REQUIRE(copied.load(std::span<const char8_t>((const char8_t*)buf2.data(), str2.size())));
+    CHECK(copied.size() == 1001);
+    auto copy = copied.sym(name(42));
+    CHECK(copy.view() == name(42));
+    auto begin2 = (const char*)buf2.data(), end2 = begin2 + str2.size();
+    CHECK((copy.c_str() < begin2 || end2 <= copy.c_str()));
+
+    // malformed
+    fe::SymPool other;
+    CHECK(!other.load(image.subspan(0, image.size() - 8)));
+    CHECK(!other.load(image.subspan(0, 16)));
+    buf[0] ^= 1;
+    CHECK(!other.load(image));
+    CHECK(other.size() == 0);
+    buf[0] ^= 1;
+
+    // layout: Header{magic, probe, num_strings, capacity, size} | index[capacity] | records
+    auto malformed = [&](auto f) {
+        auto copy = buf;
+        auto slot = std::find_if(copy.begin() + 5, copy.begin() + 5 + copy[3], [](uint64_t o) { return o != 0; });
+        f(copy, (fe::Sym::String*)((char*)copy.data() + *slot));
+        fe::SymPool pool;
+        auto res = pool.load(std::span<const char8_t>((const char8_t*)copy.data(), str.size()));
+        return !res && pool.size() == 0;
+    };
+    // ordinals handed out before would clash with the image's ones
+    fe::SymPool numbered;
+    CHECK(numbered.ordinal(numbered.sym("ab")) == 0); // packed
+    CHECK(!numbered.load(image));
+    CHECK(numbered.ordinal(numbered.sym("ab")) == 0);
+    CHECK(numbered.num_ordinals() == 1);
+
+    CHECK(malformed([](auto&, auto) {}) == false); // sanity check
+    CHECK(malformed([](auto&, auto str) { str->size = 1u << 30; }));
+    CHECK(malformed([](auto&, auto str) { str->chars[str->size] = 'x'; }));
+    CHECK(malformed([](auto&, auto str) { str->ordinal = 1000; })); // >= num_strings
+    CHECK(malformed([](auto&, auto str) { str->ordinal = fe::Sym::String::No_Ordinal; }));
+    CHECK(malformed([](auto&, auto str) { str->ordinal = str->ordinal == 0 ? 1 : 0; })); // duplicate
+    CHECK(malformed([](auto& copy, auto) { copy[2] = 999; }));                             // num_strings
+    CHECK(malformed([](auto& copy, auto) { copy[2] = copy[3]; }));                         // full index
+    CHECK(malformed([](auto& copy, auto) {                                                 // beyond the image
+        *std::find_if(copy.begin() + 5, copy.end(), [](uint64_t o) { return o != 0; }) = copy[4] - 8;
+    }));
+}
+
+TEST_CASE("SymPool - epochs") {
+    fe::SymPool syms;
+    auto keyword = syms.sym("long_keyword"); // pinned
+    CHECK(syms.epoch() == fe::SymPool::Pinned);
+
+    auto e1 = syms.open_epoch();
+    syms.sym("temporary_1");
+    syms.sym("misspeled_name");
+    auto kept = syms.sym("used_in_both").c_str();
+    CHECK(syms.epoch() == e1);
+    CHECK(syms.sym("long_keyword") == keyword);
+    CHECK(syms.size() == 4);
+
+    auto e2 = syms.open_epoch();
+    CHECK(e2 != e1);
+    CHECK(syms.sym("used_in_both").c_str() == kept); // borrowed from e1 - no copy
+    auto fresh = syms.sym("only_in_epoch_2");
+    auto pin   = syms.pin("pinned_while_in_epoch");
+    CHECK(syms.num_epochs() == 2);
+    CHECK(syms.size() == 6);
+
+    syms.retire(e1);
+    CHECK(syms.num_epochs() == 2); // e2 still borrows from e1
+    CHECK(syms.sym("used_in_both").c_str() == kept);
+    CHECK(fresh.view() == "only_in_epoch_2");
+    CHECK(syms.epoch() == e2);
+
+    syms.retire(e2);
+    CHECK(syms.num_epochs() == 0); // reclaims e1, too
+    CHECK(syms.epoch() == fe::SymPool::Pinned);
+    CHECK(syms.size() == 2);
+    CHECK(keyword.view() == "long_keyword");
+    CHECK(syms.sym("pinned_while_in_epoch") == pin);
+
+    // a String the pinned generation borrows pins its Epoch
+    auto e3    = syms.open_epoch();
+    auto later = syms.sym("pinned_later");
+    CHECK(syms.pin("pinned_later") == later);
+    syms.retire(e3);
+    CHECK(syms.num_epochs() == 1);
+    CHECK(syms.sym("pinned_later") == later);
+
+    auto moved = fe::SymPool(std::move(syms));
+    auto e4    = moved.open_epoch();
+    for (int i = 0; i != 10000; ++i) moved.sym("epoch_symbol_" + std::to_string(i)); // many pages
+    CHECK(moved.sym("pinned_later") == later);
+    CHECK(moved.size() == 10003);
+    moved.retire(e4);
+    CHECK(moved.size() == 3);
+    CHECK(moved.num_epochs() == 1);
+}
+
+TEST_CASE("SymVector/SymBitset") {
+    fe::SymPool syms;
+    std::vector<fe::Sym> keys; // short and long ones
+    for (int i = 0; i != 1000; ++i) keys.emplace_back(syms.sym((i % 2 ? "s" : "long_symbol_") + std::to_string(i)));
+
+    CHECK(syms.num_ordinals() == 0);
+    CHECK(syms.find_ordinal(keys[0]) == fe::Sym::String::No_Ordinal);
+    CHECK(syms.find_ordinal(keys[1]) == fe::Sym::String::No_Ordinal);
+    for (uint32_t i = 0; i != 1000; ++i) CHECK(syms.ordinal(keys[i]) == i); // dense and in order of request
+    for (uint32_t i = 0; i != 1000; ++i) CHECK(syms.find_ordinal(keys[i]) == i);
+    CHECK(syms.ordinal(fe::Sym()) == 1000);
+    CHECK(syms.ordinal(syms.sym("s1")) == 1);
+    CHECK(syms.num_ordinals() == 1001);
+
+    fe::SymVector<int> vec(syms);
+    CHECK(vec.find(keys[3]) == nullptr);
+    for (int i = 0; i < 1000; i += 3) vec[keys[i]] = i;
+    for (int i = 0; i != 1000; ++i) {
+        auto p = vec.find(keys[i]);
+        REQUIRE(p);
+        CHECK(*p == (i % 3 == 0 ? i : 0));
+    }
+    auto fresh = syms.sym("fresh_symbol");
+    CHECK(std::as_const(vec).find(fresh) == nullptr);
+    vec[fresh] = 23;
+    CHECK(vec[fresh] == 23);
+    CHECK(vec.size() == syms.num_ordinals());
+
+    fe::SymBitset set(syms);
+    CHECK(set.none());
+    for (int i = 0; i != 1000; i += 2) set.set(keys[i]);
+    CHECK(set.count() == 500);
+    for (int i = 0; i != 1000; ++i) CHECK(set.test(keys[i]) == (i % 2 == 0));
+    CHECK(!set.test(syms.sym("another_fresh_symbol")));
+    CHECK(syms.find_ordinal(syms.sym("another_fresh_symbol")) == fe::Sym::String::No_Ordinal); // test doesn't assign
+    CHECK(!set.test_and_set(keys[1]));
+    CHECK(set.test_and_set(keys[1]));
+    set.reset(keys[0]);
+    set.reset(keys[1]);
+    CHECK(set.count() == 499);
+    set.clear();
+    CHECK(set.none());
+}
+
+TEST_CASE("SymMap/SymSet") {
+    fe::SymPool syms;
+    std::vector<fe::Sym> keys; // short and long ones
+    for (int i = 0; i != 1000; ++i) keys.emplace_back(syms.sym((i % 2 ? "s" : "long_symbol_") + std::to_string(i)));
+
+    fe::SymMap<int> map;
+    fe::SymSet set;
+    for (int i = 0; i != 1000; ++i) {
+        CHECK(map.emplace(keys[i], i).second);
+        CHECK(set.insert(keys[i]).second);
+    }
+    CHECK(!map.emplace(keys[0], 23).second);
+    CHECK(map.size() == 1000);
+    CHECK(set.size() == 1000);
+
+    for (int i = 0; i < 1000; i += 3) {
+        CHECK(map.erase(keys[i]) == 1);
+        CHECK(set.erase(keys[i]) == 1);
+    }
+    CHECK(map.erase(keys[0]) == 0);
+    for (int i = 0; i != 1000; ++i) {
+        auto it = map.find(keys[i]);
+        CHECK((it == map.end()) == (i % 3 == 0));
+        if (it != map.end()) CHECK(it->second == i);
+        CHECK(set.contains(keys[i]) == (i % 3 != 0));
+    }
+
+    for (int i = 0; i < 1000; i += 3) map[keys[i]] = -i; // reuse the deleted slots
+    int sum = 0;
+    for (const auto& [sym, i] : map) sum += i < 0 ? -i : i;
+    CHECK(sum == 999 * 1000 / 2);
+
+    auto copy = map;
+    map.clear();
+    CHECK(map.empty());
+    CHECK(copy.size() == 1000);
+    CHECK(copy[keys[42]] == -42);
+    auto moved = std::move(copy);
+    CHECK(moved.size() == 1000);
+    CHECK(copy.empty());
+    CHECK(!copy.contains(keys[42]));
+
+    fe::Arena arena;
+    using Alloc = fe::Arena::Allocator<std::pair<fe::Sym, int>>;
+    fe::SymMap<int, Alloc> in_arena(arena.allocator<std::pair<fe::Sym, int>>());
+    for (int i = 0; i != 1000; ++i) in_arena.insert_or_assign(keys[i], i);
+    CHECK(in_arena.size() == 1000);
+    CHECK(in_arena[keys[999]] == 999);
+
+    // clustering keys: aligned pointers - with an identity hash, these would all end up in the same Group
+    fe::FlatSet<uintptr_t, decltype([](uintptr_t p) { return size_t(fe::mix(p)); })> ptrs;
+    for (uintptr_t i = 0; i != 4096; ++i) ptrs.insert(i << 12);
+    CHECK(ptrs.size() == 4096);
+    CHECK(ptrs.capacity() <= 8192);
+    for (uintptr_t i = 0; i != 4096; ++i) CHECK(ptrs.contains(i << 12));
+    CHECK(!ptrs.contains(1));
+
+    // arguments that refer into the map itself survive a rehash
+    auto str = std::string("a string that is too long for the small string optimization");
+    fe::FlatMap<int, std::string> strs;
+    strs.try_emplace(0, str);
+    for (int i = 1; i != 1000; ++i) {
+        if (i % 2)
+            strs.try_emplace(i, strs.find(i - 1)->second);
+        else
+            strs.insert_or_assign(i, strs[i - 1]);
+    }
+    CHECK(strs.size() == 1000);
+    for (const auto& [_, s] : strs) CHECK(s == str);
+}
+
+TEST_CASE("ConcurrentSymPool") {
+    fe::ConcurrentSymPool syms(4);
+    CHECK(syms.num_shards() == 4);
+
+    constexpr size_t Num_Threads = 4, Num_Syms = 2000;
+    std::vector<std::vector<fe::Sym>> res(Num_Threads);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t != Num_Threads; ++t)
+        threads.emplace_back([&, t]() {
+            for (size_t i = 0; i != Num_Syms; ++i) res[t].emplace_back(syms.sym("symbol_" + std::to_string(i)));
+        });
+    for (auto& thread : threads) thread.join();
+
+    for (size_t i = 0; i != Num_Syms; ++i) {
+        CHECK(res[0][i].view() == "symbol_" + std::to_string(i));
+        for (size_t t = 1; t != Num_Threads; ++t) CHECK(res[0][i] == res[t][i]);
+    }
+    CHECK(syms.sym("abc") == syms.sym("abc"s));
+    CHECK(syms.sym("abcdefghij") == syms.sym("abcdefghij"s));
+    CHECK(syms.sym_fold("ABCDEFGHIJ") == syms.sym("abcdefghij"));
+    CHECK(syms.sym("") == fe::Sym());
 }
 
 TEST_CASE("utf8") {
@@ -120,8 +884,117 @@ TEST_CASE("utf8") {
     fe::utf8::encode(oss, U'𐄂');
     fe::utf8::encode(oss, U'𐀮');
     CHECK(oss.str() == "a£λ𐄂𐀮");
+
+    char8_t buf[32];
+    auto end = fe::utf8::encode(buf, U"a£λ𐄂𐀮");
+    CHECK(std::u8string_view(buf, end - buf) == u8"a£λ𐄂𐀮");
+    CHECK(fe::utf8::encode(buf, char32_t(0x110000)) == nullptr);
+
+    std::u8string_view ascii = u8"0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz";
+    for (size_t i = 0; i != ascii.size(); ++i) {
+        std::u8string str(ascii);
+        str[i] = 0xc3;
+        CHECK(fe::utf8::skip_ascii(str.data(), str.data() + str.size()) == str.data() + i);
+    }
+    CHECK(fe::utf8::skip_ascii(ascii.data(), ascii.data() + ascii.size()) == ascii.data() + ascii.size());
+
+    CHECK(fe::utf8::is_valid(ascii));
+    CHECK(fe::utf8::is_valid(u8"a£λ𐄂𐀮 and some more ASCII to get past the SIMD block size £λ𐄂𐀮"));
+    CHECK(!fe::utf8::is_valid(u8"abc\xff"));
+    CHECK(!fe::utf8::is_valid(u8"abc\xc3"));         // truncated
+    CHECK(!fe::utf8::is_valid(u8"abc\xc0\xaf"));     // overlong
+    CHECK(!fe::utf8::is_valid(u8"abc\xed\xa0\x80")); // surrogate
     CHECK(fe::utf8::any('a', 'b', 'c')('a'));
     CHECK(fe::utf8::any('a', 'b', 'c')('b'));
     CHECK(fe::utf8::any('a', 'b', 'c')('c'));
     CHECK(fe::utf8::any('a', 'b', 'c')('x') == false);
 }
+
+TEST_CASE("utf8 - classes") {
+    namespace utf8 = fe::utf8;
+    for (char32_t c = 0; c != 0x80; ++c) { // default "C" locale
+        CHECK(utf8::isalnum(c) == bool(std::isalnum(c)));
+        CHECK(utf8::isalpha(c) == bool(std::isalpha(c)));
+        CHECK(utf8::isblank(c) == bool(std::isblank(c)));
+        CHECK(utf8::iscntrl(c) == bool(std::iscntrl(c)));
+        CHECK(utf8::isdigit(c) == bool(std::isdigit(c)));
+        CHECK(utf8::isgraph(c) == bool(std::isgraph(c)));
+        CHECK(utf8::islower(c) == bool(std::islower(c)));
+        CHECK(utf8::isprint(c) == bool(std::isprint(c)));
+        CHECK(utf8::ispunct(c) == bool(std::ispunct(c)));
+        CHECK(utf8::isspace(c) == bool(std::isspace(c)));
+        CHECK(utf8::isupper(c) == bool(std::isupper(c)));
+        CHECK(utf8::isxdigit(c) == bool(std::isxdigit(c)));
+        CHECK(utf8::tolower(c) == char32_t(std::tolower(c)));
+        CHECK(utf8::toupper(c) == char32_t(std::toupper(c)));
+    }
+    CHECK(!utf8::isalpha(U'ä'));
+    CHECK(!utf8::isspace(utf8::EoF));
+    CHECK(utf8::toupper(U'ä') == U'ä');
+    static_assert(utf8::isdigit('7') && !utf8::isdigit(0x1d7ce));
+
+    CHECK(utf8::isuspace(U'\u00a0'));
+    CHECK(utf8::isuspace(U'\u2028'));
+    CHECK(!utf8::isuspace(U'\u200b')); // ZERO WIDTH SPACE is no White_Space
+
+    CHECK(utf8::isxidstart('a'));
+    CHECK(!utf8::isxidstart('_'));
+    CHECK(!utf8::isxidstart('1'));
+    CHECK(utf8::isxidcontinue('_'));
+    CHECK(utf8::isxidcontinue('1'));
+    CHECK(utf8::isxidstart(U'ä'));
+    CHECK(!utf8::isxidstart(U'×'));
+    CHECK(utf8::isxidstart(U'λ'));
+    CHECK(utf8::isxidstart(U'変'));
+    CHECK(utf8::isxidstart(0x2a700)); // CJK Extension C
+    CHECK(!utf8::isxidstart(U'·'));
+    CHECK(utf8::isxidcontinue(U'·'));
+    CHECK(!utf8::isxidstart(0x0301)); // COMBINING ACUTE ACCENT
+    CHECK(utf8::isxidcontinue(0x0301));
+    CHECK(utf8::isxidcontinue(0xe0100)); // VARIATION SELECTOR-17
+    CHECK(!utf8::isxidstart(U'€'));
+    CHECK(!utf8::isxidcontinue(U'😀'));
+    CHECK(!utf8::isxidcontinue(utf8::EoF));
+    CHECK(!utf8::isxidcontinue(0x10ffff));
+}
+
+TEST_CASE("utf8 - folding") {
+    namespace utf8 = fe::utf8;
+    std::u8string ascii;
+    for (size_t i = 0; i != 3; ++i)
+        for (char8_t c = 0; c != 0x80; ++c) ascii += c;
+    ascii += u8"Ä"; // some non-ASCII bytes that must survive
+    for (size_t n = 0; n <= ascii.size(); ++n) { // hits all SIMD/SWAR/scalar tails
+        std::u8string out(n, u8'?');
+        CHECK(utf8::lower_ascii(ascii.data(), ascii.data() + n, out.data()) == out.data() + n);
+        for (size_t i = 0; i != n; ++i) CHECK(out[i] == (ascii[i] < 0x80 ? utf8::tolower(ascii[i]) : ascii[i]));
+    }
+
+    static_assert(utf8::fold('A') == 'a' && utf8::fold('a') == 'a' && utf8::fold('_') == '_');
+    CHECK(utf8::fold(U'Ä') == U'ä');
+    CHECK(utf8::fold(U'×') == U'×');
+    CHECK(utf8::fold(U'Ā') == U'ā');
+    CHECK(utf8::fold(U'ā') == U'ā');
+    CHECK(utf8::fold(U'Ÿ') == U'ÿ');
+    CHECK(utf8::fold(U'Σ') == U'σ');
+    CHECK(utf8::fold(U'ς') == U'σ');
+    CHECK(utf8::fold(U'Ж') == U'ж');
+    CHECK(utf8::fold(U'Ё') == U'ё');
+    CHECK(utf8::fold(U'ß') == U'ß'); // full folding would yield "ss"
+    CHECK(utf8::fold(U'ẞ') == U'ß'); // LATIN CAPITAL LETTER SHARP S
+    CHECK(utf8::fold(U'İ') == U'İ'); // only Turkic folding yields 'i'
+    CHECK(utf8::fold(U'K') == U'k'); // KELVIN SIGN
+    CHECK(utf8::fold(U'ſ') == U's'); // LATIN SMALL LETTER LONG S
+    CHECK(utf8::fold(U'𐐀') == U'𐐨'); // DESERET
+    CHECK(utf8::fold(U'変') == U'変');
+    CHECK(utf8::fold(utf8::EoF) == utf8::EoF);
+
+    CHECK(utf8::fold("Hello, World!") == "hello, world!");
+    CHECK(utf8::fold("ΣΊΣΥΦΟΣ Straße ǅ") == "σίσυφοσ straße ǆ");
+    CHECK(utf8::fold("Ⱥ") == "ⱥ");                   // grows from 2 to 3 bytes
+    CHECK(utf8::fold("KK") == "kk");                 // shrinks
+    CHECK(utf8::fold("AB\xff\xc3") == "ab\xff\xc3"); // invalid bytes are kept as is
+    CHECK(utf8::fold("\xc3" "A\xe2\x84" "B") == "\xc3" "a\xe2\x84" "b"); // ... but ASCII behind them is folded
+    auto long_str = std::string(300, 'X') + "Ä";
+    CHECK(utf8::fold(long_str) == std::string(300, 'x') + "ä");
+}
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""Generates include/fe/fold.h - Unicode simple case folding as a sorted table of runs.
+
+Uses the Unicode database that ships with your Python; run from the repository's root:
+    python3 tools/gen_fold.py > include/fe/fold.h
+"""
+
+import unicodedata
+
+# Simple case folding - i.e. status C and S in CaseFolding.txt:
+# Python's casefold is the full folding (C + F); where this yields several chars, the S mapping - if any - coincides
+# with the simple lowercase mapping.
+fold = {}
+for c in range(0x110000):
+    if 0xD800 <= c <= 0xDFFF:
+        continue
+    s = chr(c)
+    f = s.casefold()
+    if len(f) != 1:
+        f = s.lower()
+    if len(f) == 1 and ord(f) != c:
+        fold[c] = ord(f)
+
+# ASCII is left to utf8::tolower in fe/utf8.h
+assert {c: d for c, d in fold.items() if c <= 0x7F} == {c: c + 32 for c in range(0x41, 0x5B)}
+
+
+def size(c):
+    return len(chr(c).encode())
+
+
+# folding may only grow 2-byte sequences by one byte - see utf8::fold_size
+assert all(size(d) <= size(c) or (size(c), size(d)) == (2, 3) for c, d in fold.items())
+
+# runs of chars with the same delta - either consecutive or every other one (upper/lower pairs)
+runs = []  # [first, last, delta, step]
+for c in sorted(fold):
+    if c <= 0x7F:
+        continue
+    delta = fold[c] - c
+    if runs and runs[-1][2] == delta:
+        first, last, _, step = runs[-1]
+        if c - last == step or (last == first and c - last in (1, 2)):
+            runs[-1] = [first, c, delta, c - last]
+            continue
+    runs.append([c, c, delta, 1])
+
+print(f"""#pragma once
+
+#include <cstdint>
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+
+#include "fe/utf8.h"
+
+// clang-format off
+// Generated by tools/gen_fold.py from Unicode {unicodedata.unidata_version} - do not edit.
+
+namespace fe::utf8 {{
+
+namespace folding {{
+
+/// Chars in [Run::first, Run::last] that are Run::step apart fold to `c + Run::delta`.
+struct Run {{
+    char32_t first, last;
+    int32_t delta;
+    uint32_t step;
+}};
+
+/// Sorted by Run::first; ASCII is left to utf8::tolower.
+inline constexpr Run Runs[] = {{""")
+for first, last, delta, step in runs:
+    print(f"    {{0x{first:05x}, 0x{last:05x}, {delta:6}, {step}}},")
+print("""};
+
+} // namespace folding
+
+/// @name Case Folding
+///@{
+/// Unicode [simple case folding](https://www.unicode.org/Public/UCD/latest/ucd/CaseFolding.txt) - i.e. each char
+/// folds to exactly one char - for case-insensitive comparisons: `fold(c1) == fold(c2)`.
+/// Mostly this is the lowercase letter, but e.g. U+212A KELVIN SIGN also folds to `k`, and U+00DF `ß` stays as is.
+/// ASCII is a mere table lookup; everything else is a binary search over the folding::Runs.
+constexpr char32_t fold(char32_t c) {
+    if (c <= 0x7f) return tolower(c);
+    auto run = std::upper_bound(std::begin(folding::Runs), std::end(folding::Runs), c,
+                                [](char32_t c, const folding::Run& run) { return c < run.first; });
+    if (run == std::begin(folding::Runs)) return c;
+    --run;
+    return c <= run->last && (c - run->first) % run->step == 0 ? char32_t(c + run->delta) : c;
+}
+
+/// Upper bound for the number of bytes utf8::fold writes for @p n input bytes:
+/// Only some 2-byte sequences grow - by one byte.
+constexpr size_t fold_size(size_t n) { return n + n / 2; }
+
+/// Writes the folding of the UTF-8 string [@p begin, @p end) to @p out.
+/// @p out must have room for utf8::fold_size bytes; it may *not* overlap with the input.
+/// ASCII runs go through utf8::lower_ascii; the bytes of invalid sequences are copied as is - one by one.
+/// @returns the position right behind the written bytes.
+inline char8_t* fold(const char8_t* begin, const char8_t* end, char8_t* out) {
+    for (auto p = begin; p != end;) {
+        auto ascii = skip_ascii(p, end);
+        out        = lower_ascii(p, ascii, out);
+        if ((p = ascii) == end) break;
+
+        auto seq = p;
+        auto c   = decode(p, end);
+        if (c == Null) { // invalid: decode may have consumed the next byte - even if it's ASCII, so resume there
+            *out++ = *seq;
+            p      = seq + 1;
+            continue;
+        }
+        auto d = fold(c);
+        out    = c != d ? encode(out, d) : std::copy(seq, p, out);
+    }
+    return out;
+}
+
+/// Folds @p s into a buffer on the stack - or on the heap, if @p s is long - and invokes @p f with it.
+template<class F> decltype(auto) fold(std::string_view s, F f) {
+    static constexpr size_t Stack_Size = 256;
+    auto begin = (const char8_t*)s.data(), end = begin + s.size();
+    if (fold_size(s.size()) <= Stack_Size) {
+        char8_t buf[Stack_Size];
+        return f(std::string_view((const char*)buf, fold(begin, end, buf) - buf));
+    }
+    auto buf = std::u8string(fold_size(s.size()), u8'\\0');
+    return f(std::string_view((const char*)buf.data(), fold(begin, end, buf.data()) - buf.data()));
+}
+
+/// Folds all of @p s.
+inline std::string fold(std::string_view s) { return fold(s, [](std::string_view s) { return std::string(s); }); }
+///@}
+
+} // namespace fe::utf8
+// clang-format on""")
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""Generates include/fe/xid.h - two-stage tables for Unicode XID_Start/XID_Continue.
+
+Uses the Unicode database that ships with your Python; run from the repository's root:
+    python3 tools/gen_xid.py > include/fe/xid.h
+"""
+
+import unicodedata
+
+BLOCK = 256
+
+start = {c for c in range(0x110000) if chr(c).isidentifier()} - {ord("_")}  # Python also admits '_'
+cont = {c for c in range(0x110000) if ("a" + chr(c)).isidentifier()}
+
+# variation selectors E0100..E01EF are handled separately; this keeps stage 1 short
+cont_planes = {c for c in cont if c < 0xE0000}
+assert cont - cont_planes == set(range(0xE0100, 0xE01F0))
+limit = (max(start | cont_planes) // BLOCK) + 1
+
+zero = tuple([0] * (2 * BLOCK // 64))
+blocks = {zero: 0}
+stage1 = []
+for b in range(limit):
+    words = []
+    for prop in (start, cont_planes):
+        for w in range(BLOCK // 64):
+            bits = 0
+            for i in range(64):
+                if b * BLOCK + w * 64 + i in prop:
+                    bits |= 1 << i
+            words.append(bits)
+    stage1.append(blocks.setdefault(tuple(words), len(blocks)))
+assert len(blocks) < 256
+
+print(f"""#pragma once
+
+#include <cstdint>
+
+#include "fe/utf8.h"
+
+// clang-format off
+// Generated by tools/gen_xid.py from Unicode {unicodedata.unidata_version} - do not edit.
+
+namespace fe::utf8 {{
+
+namespace xid {{
+
+/// Code points below this are covered by Stage1.
+static constexpr char32_t Limit = 0x{limit * BLOCK:x};
+
+/// `Stage1[c >> 8]` is the index of the block of `c` in Stage2.
+inline constexpr uint8_t Stage1[] = {{""")
+for i in range(0, len(stage1), 32):
+    print("    " + " ".join(f"{x:3}," for x in stage1[i : i + 32]))
+print("""};
+
+/// Per block: 4 words of XID_Start bits followed by 4 words of XID_Continue bits.
+inline constexpr uint64_t Stage2[][8] = {""")
+for words in sorted(blocks, key=blocks.get):
+    print("    {" + ", ".join(f"0x{w:016x}" for w in words) + "},")
+print("""};
+
+inline bool test(char32_t c, size_t offset) {
+    auto block = Stage1[c >> 8];
+    auto i     = c & 0xff;
+    return (Stage2[block][offset + (i >> 6)] >> (i & 63)) & 1;
+}
+
+} // namespace xid
+
+/// @name XID
+///@{
+/// [Unicode identifiers](https://www.unicode.org/reports/tr31/) via two-stage lookup tables.
+/// ASCII is answered from the class table in fe/utf8.h; everything else costs two loads.
+/// Use like this in your Lexer:
+/// ```
+/// if (accept(utf8::isxidstart)) {
+///     while (accept(utf8::isxidcontinue)) {}
+///     return {loc_, driver_.sym(str())};
+/// }
+/// ```
+inline bool isxidstart(char32_t c) {
+    if (c <= 0x7f) return isalpha(c);
+    return c < xid::Limit && xid::test(c, 0);
+}
+
+inline bool isxidcontinue(char32_t c) {
+    if (c <= 0x7f) return isalnum(c) || c == '_';
+    if (c < xid::Limit) return xid::test(c, 4);
+    return 0xe0100 <= c && c <= 0xe01ef; // variation selectors
+}
+///@}
+
+} // namespace fe::utf8
+// clang-format on""")